@@ -0,0 +1,19 @@
+// Stand-in for the Electron runtime used by launch_bench. It reports the
+// moment it was exec'd through the pipe named by LAUNCH_BENCH_FD and exits.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+int main() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  uint64_t now = (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+
+  const char *fd = getenv("LAUNCH_BENCH_FD");
+  if (!fd) return 1;
+
+  return write(atoi(fd), &now, sizeof(now)) == sizeof(now) ? 0 : 1;
+}
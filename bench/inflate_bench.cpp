@@ -0,0 +1,165 @@
+// Measures how fast each built-in inflate backend extracts an archive.
+//
+//   inflate_bench <archive.zip> [iterations]
+//
+// Every deflated entry of the archive, typically an Electron release, is
+// inflated in memory on one thread, both streamed the way entries too large
+// for memory are and at once where the backend can. Each mode runs
+// `iterations` times after one untimed run that also checks the CRC-32 of
+// every entry, and the median is reported in megabytes of inflated output
+// per second. Nothing is written to disk.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "../src/archive.hpp"
+#include "../src/crc32.hpp"
+#include "../src/inflate.hpp"
+#include "../src/mapped_file.hpp"
+
+#define LOCAL_HEADER_SIZE 30
+
+struct Entry {
+  const unsigned char *data;
+  uint64_t length;
+  uint64_t size;
+  uint32_t crc32;
+};
+
+static uint64_t now() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+}
+
+static bool findEntries(const MappedFile &archive,
+                        std::vector<Entry> *entries) {
+  size_t tailSize = archive.size() < ARCHIVE_TAIL_SIZE ? archive.size()
+                                                        : ARCHIVE_TAIL_SIZE;
+  const unsigned char *tail = archive.data() + archive.size() - tailSize;
+
+  CentralDirectory directory;
+  std::vector<ArchiveEntry> parsed;
+  if (!findCentralDirectory(tail, tailSize, archive.size(), &directory) ||
+      !parseCentralDirectory(archive.data() + directory.offset,
+                             (size_t)directory.size, directory, &parsed)) {
+    return false;
+  }
+
+  for (const ArchiveEntry &entry : parsed) {
+    if (entry.method != ARCHIVE_METHOD_DEFLATED) continue;
+
+    const unsigned char *header = archive.data() + entry.localHeaderOffset;
+    uint64_t start = entry.localHeaderOffset + LOCAL_HEADER_SIZE +
+                     (header[26] | header[27] << 8) +
+                     (header[28] | header[29] << 8);
+    if (start + entry.compressedSize > archive.size()) return false;
+
+    entries->push_back({archive.data() + start, entry.compressedSize,
+                        entry.size, entry.crc32});
+  }
+
+  return true;
+}
+
+// Inflates every entry, checking their CRC-32 if `verify` is set.
+static bool inflateAll(const InflateBackend &backend, bool whole,
+                       const std::vector<Entry> &entries, bool verify) {
+  for (const Entry &entry : entries) {
+    uint64_t written = 0;
+    uint32_t crc32 = CRC32_INIT;
+
+    if (whole && entry.size <= INFLATE_WHOLE_LIMIT) {
+      std::unique_ptr<unsigned char[]> output(
+          new unsigned char[(size_t)entry.size]);
+      if (!backend.whole(entry.data, (size_t)entry.length, output.get(),
+                         (size_t)entry.size)) {
+        return false;
+      }
+
+      written = entry.size;
+      if (verify) crc32 = updateCrc32(crc32, output.get(), (size_t)entry.size);
+    } else {
+      std::unique_ptr<Inflater> inflater(backend.stream());
+      bool inflated = inflater->inflate(
+          entry.data, (size_t)entry.length, true,
+          [&](const unsigned char *data, size_t length) {
+            if (verify) crc32 = updateCrc32(crc32, data, length);
+            written += length;
+            return true;
+          });
+      if (!inflated || !inflater->done()) return false;
+    }
+
+    if (written != entry.size || (verify && crc32 != entry.crc32)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <archive.zip> [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  int iterations = argc > 2 ? atoi(argv[2]) : 5;
+  if (iterations <= 0) iterations = 5;
+
+  MappedFile archive;
+  std::vector<Entry> entries;
+  if (!archive.open(argv[1]) || !findEntries(archive, &entries)) {
+    fprintf(stderr, "Cannot read %s\n", argv[1]);
+    return 1;
+  }
+
+  uint64_t compressed = 0, inflated = 0;
+  for (const Entry &entry : entries) {
+    compressed += entry.length;
+    inflated += entry.size;
+  }
+
+  printf("archive: %s\n", argv[1]);
+  printf("deflated entries: %zu, %.1f MB inflating to %.1f MB\n\n",
+         entries.size(), compressed / 1e6, inflated / 1e6);
+  printf("%-12s %-8s %6s %10s %10s\n", "backend", "mode", "runs", "p50 (ms)",
+         "MB/s");
+
+  bool failed = false;
+
+  for (const InflateBackend *backend : inflateBackends()) {
+    for (int whole = 0; whole <= 1; whole++) {
+      const char *mode = whole ? "whole" : "stream";
+      if (whole && !backend->whole) continue;
+
+      if (!inflateAll(*backend, whole, entries, true)) {
+        printf("%-12s %-8s %s\n", backend->name, mode, "failed");
+        failed = true;
+        continue;
+      }
+
+      std::vector<uint64_t> samples;
+      for (int i = 0; i < iterations; i++) {
+        uint64_t start = now();
+        inflateAll(*backend, whole, entries, false);
+        samples.push_back(now() - start);
+      }
+
+      std::sort(samples.begin(), samples.end());
+      uint64_t median = samples[samples.size() / 2];
+
+      printf("%-12s %-8s %6d %10.1f %10.1f\n", backend->name, mode,
+             iterations, median / 1e6, inflated * 1e3 / median);
+    }
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,282 @@
+// Measures launcher-to-exec latency of the launch stub.
+//
+//   launch_bench <launcher> <fake-electron> [iterations]
+//
+// A throwaway HOME with `.electron-global/<major>/electron` pointing at the
+// fake runtime is created, then the launcher is run `iterations` times with
+// and without a launch plan, with a warm page cache and, when allowed to
+// write /proc/sys/vm/drop_caches, a dropped one. Each child reports the time
+// right before it execs the launcher and the fake runtime reports the time it
+// was exec'd, both through a pipe. Page faults are taken from wait4() and
+// cover the launcher and the tiny fake runtime together.
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../src/platform.hpp"
+#include "../src/store.hpp"
+
+#define BENCH_MAJOR "99"
+
+struct Sample {
+  uint64_t latency;
+  long minorFaults;
+  long majorFaults;
+};
+
+static uint64_t now() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+}
+
+static bool writeFile(const std::string &path, const std::string &data,
+                      mode_t mode) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+  if (fd < 0) return false;
+
+  bool written = write(fd, data.data(), data.size()) == (ssize_t)data.size();
+  return close(fd) == 0 && written;
+}
+
+static bool copyFile(const std::string &from, const std::string &to) {
+  FILE *file = fopen(from.c_str(), "rb");
+  if (!file) return false;
+
+  std::string data;
+  char buffer[65536];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.append(buffer, length);
+  }
+  fclose(file);
+
+  return writeFile(to, data, 0755);
+}
+
+static bool dropCaches() {
+  sync();
+
+  int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+  if (fd < 0) return false;
+
+  bool dropped = write(fd, "3", 1) == 1;
+  close(fd);
+
+  return dropped;
+}
+
+// Counts the shared objects the dynamic loader maps for `path`, the same way
+// ldd does.
+static int countDsos(const char *path) {
+  int pipes[2];
+  if (pipe(pipes) != 0) return -1;
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    dup2(pipes[1], STDOUT_FILENO);
+    close(pipes[0]);
+    setenv("LD_TRACE_LOADED_OBJECTS", "1", 1);
+    execl(path, path, (char *)nullptr);
+    _exit(127);
+  }
+
+  close(pipes[1]);
+
+  std::string output;
+  char buffer[4096];
+  ssize_t length;
+  while ((length = read(pipes[0], buffer, sizeof(buffer))) > 0) {
+    output.append(buffer, length);
+  }
+  close(pipes[0]);
+  waitpid(pid, nullptr, 0);
+
+  return (int)std::count(output.begin(), output.end(), '\n');
+}
+
+static bool runOnce(const char *launcher, const std::string &appDir,
+                    Sample *sample) {
+  int pipes[2];
+  if (pipe(pipes) != 0) return false;
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(pipes[0]);
+    if (chdir(appDir.c_str()) != 0) _exit(127);
+
+    char fd[16];
+    snprintf(fd, sizeof(fd), "%d", pipes[1]);
+    setenv("LAUNCH_BENCH_FD", fd, 1);
+
+    uint64_t start = now();
+    if (write(pipes[1], &start, sizeof(start)) != sizeof(start)) _exit(127);
+
+    execl(launcher, launcher, (char *)nullptr);
+    _exit(127);
+  }
+
+  close(pipes[1]);
+
+  uint64_t stamps[2];
+  size_t received = 0;
+  ssize_t length;
+  while (received < sizeof(stamps) &&
+         (length = read(pipes[0], (char *)stamps + received,
+                        sizeof(stamps) - received)) > 0) {
+    received += length;
+  }
+  close(pipes[0]);
+
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) != pid || received != sizeof(stamps) ||
+      !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    return false;
+  }
+
+  sample->latency = stamps[1] - stamps[0];
+  sample->minorFaults = usage.ru_minflt;
+  sample->majorFaults = usage.ru_majflt;
+
+  return true;
+}
+
+static void report(const char *name, const char *cache,
+                   std::vector<Sample> &samples) {
+  if (samples.empty()) {
+    printf("%-12s %-8s %s\n", name, cache, "no successful runs");
+    return;
+  }
+
+  std::sort(samples.begin(), samples.end(),
+            [](const Sample &a, const Sample &b) {
+              return a.latency < b.latency;
+            });
+
+  size_t p99 = std::min(samples.size() - 1, samples.size() * 99 / 100);
+  double minorFaults = 0, majorFaults = 0;
+  for (const Sample &sample : samples) {
+    minorFaults += sample.minorFaults;
+    majorFaults += sample.majorFaults;
+  }
+
+  printf("%-12s %-8s %6zu %10.1f %10.1f %10.1f %10.1f\n", name, cache,
+         samples.size(), samples[samples.size() / 2].latency / 1000.0,
+         samples[p99].latency / 1000.0, minorFaults / samples.size(),
+         majorFaults / samples.size());
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s <launcher> <fake-electron> [iterations]\n",
+            argv[0]);
+    return 1;
+  }
+
+  char launcher[PATH_MAX];
+  if (!realpath(argv[1], launcher)) {
+    fprintf(stderr, "Cannot find %s\n", argv[1]);
+    return 1;
+  }
+
+  int iterations = argc > 3 ? atoi(argv[3]) : 1000;
+  if (iterations <= 0) iterations = 1000;
+
+  char root[] = "/tmp/electron-global-bench.XXXXXX";
+  if (!mkdtemp(root)) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  std::string home = std::string(root) + "/home";
+  std::string store = home + "/" BIN_DIR;
+  std::string install = store + "/" BENCH_MAJOR;
+  std::string appDir = std::string(root) + "/app";
+  std::string executable = install + "/" ELECTRON_EXECUTABLE;
+
+  mkdir(home.c_str(), 0755);
+  mkdir(store.c_str(), 0755);
+  mkdir(install.c_str(), 0755);
+  mkdir(appDir.c_str(), 0755);
+
+  if (!copyFile(argv[2], executable) ||
+      !writeFile(appDir + "/" ELECTRON_VERSION_PATH, BENCH_MAJOR "\n", 0644)) {
+    fprintf(stderr, "Failed to set up %s\n", root);
+    return 1;
+  }
+
+  setenv(HOME_ENV, home.c_str(), 1);
+
+  std::string plan(LAUNCH_PLAN_MAGIC, sizeof(LAUNCH_PLAN_MAGIC));
+  plan.append(executable.c_str(), executable.size() + 1);
+  plan.append(executable.c_str(), executable.size() + 1);
+  plan.append(ASAR_PATH, sizeof(ASAR_PATH));
+  plan.append(2, '\0');
+
+  std::string planPath = install + "/" LAUNCH_PLAN_FILE;
+
+  printf("launcher: %s\n", launcher);
+  printf("loaded DSOs: %d\n\n", countDsos(launcher));
+  printf("%-12s %-8s %6s %10s %10s %10s %10s\n", "mode", "cache", "runs",
+         "p50 (us)", "p99 (us)", "minflt", "majflt");
+
+  bool canDrop = dropCaches();
+
+  for (int withPlan = 1; withPlan >= 0; withPlan--) {
+    const char *mode = withPlan ? "launch plan" : "store path";
+
+    if (withPlan) {
+      writeFile(planPath, plan, 0644);
+    } else {
+      unlink(planPath.c_str());
+    }
+
+    for (int cold = 0; cold <= 1; cold++) {
+      if (cold && !canDrop) {
+        printf("%-12s %-8s %s\n", mode, "dropped",
+               "skipped, cannot write /proc/sys/vm/drop_caches");
+        continue;
+      }
+
+      std::vector<Sample> samples;
+      // Cold runs are slow and mostly measure the disk, fewer are enough.
+      int runs = cold ? std::max(1, iterations / 20) : iterations;
+
+      // One untimed run so that warm numbers do not include the first load.
+      Sample sample;
+      if (!cold) runOnce(launcher, appDir, &sample);
+
+      for (int i = 0; i < runs; i++) {
+        if (cold) dropCaches();
+        if (runOnce(launcher, appDir, &sample)) samples.push_back(sample);
+      }
+
+      report(mode, cold ? "dropped" : "warm", samples);
+    }
+  }
+
+  unlink(planPath.c_str());
+  unlink(executable.c_str());
+  unlink((appDir + "/" ELECTRON_VERSION_PATH).c_str());
+  rmdir(install.c_str());
+  rmdir(store.c_str());
+  rmdir(home.c_str());
+  rmdir(appDir.c_str());
+  rmdir(root);
+
+  return 0;
+}
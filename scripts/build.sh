@@ -14,17 +14,17 @@ export TRAVIS_TAG="v${PACKAGE_VERSION}"
 if [[ "$TRAVIS_OS_NAME" == "osx" ]]; then
   make -f makefile.darwin
   OS="darwin"
-  zip "build/electron-${TRAVIS_TAG}-${OS}-ia32.zip" "build/electron"
+  zip -j "build/electron-${TRAVIS_TAG}-${OS}-ia32.zip" "build/electron" "build/electron-installer"
 else
   make -f makefile.linux
   OS="linux"
-  zip "build/electron-${TRAVIS_TAG}-${OS}-ia32.zip" "build/electron"
+  zip -j "build/electron-${TRAVIS_TAG}-${OS}-ia32.zip" "build/electron" "build/electron-installer"
 
   # TODO: I need help with it, Travis keeps throwing `ERROR: Could not invoke sanity test executable`
   # make -f makefile.win32 clean
   # make -f makefile.win32
   # OS="win32"
-  # zip -r "build/electron-${TRAVIS_TAG}-${OS}-ia32.zip" "build/electron.exe"
+  # zip -j "build/electron-${TRAVIS_TAG}-${OS}-ia32.zip" "build/electron.exe" "build/electron-installer.exe"
 fi
 
 echo $OS
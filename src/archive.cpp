@@ -0,0 +1,185 @@
+#include "archive.hpp"
+
+#include <algorithm>
+
+#define END_OF_DIRECTORY_SIGNATURE 0x06054b50
+#define END_OF_DIRECTORY_SIZE 22
+#define ZIP64_LOCATOR_SIGNATURE 0x07064b50
+#define ZIP64_LOCATOR_SIZE 20
+#define ZIP64_END_OF_DIRECTORY_SIGNATURE 0x06064b50
+#define ZIP64_END_OF_DIRECTORY_SIZE 56
+#define DIRECTORY_HEADER_SIGNATURE 0x02014b50
+#define DIRECTORY_HEADER_SIZE 46
+#define LOCAL_HEADER_SIZE 30
+#define ZIP64_EXTRA_ID 0x0001
+#define MADE_BY_UNIX 3
+
+static uint16_t read16(const unsigned char *data) {
+  return (uint16_t)(data[0] | data[1] << 8);
+}
+
+static uint32_t read32(const unsigned char *data) {
+  return (uint32_t)read16(data) | (uint32_t)read16(data + 2) << 16;
+}
+
+static uint64_t read64(const unsigned char *data) {
+  return (uint64_t)read32(data) | (uint64_t)read32(data + 4) << 32;
+}
+
+bool findCentralDirectory(const unsigned char *tail, size_t length,
+                          uint64_t archiveSize, CentralDirectory *directory) {
+  if (length < END_OF_DIRECTORY_SIZE || length > archiveSize) return false;
+
+  // The record is followed by its comment, which reaches the end of the
+  // archive. Searching backwards finds it before any signature-like bytes in
+  // the comment.
+  for (size_t i = length - END_OF_DIRECTORY_SIZE + 1; i-- > 0;) {
+    const unsigned char *record = tail + i;
+    if (read32(record) != END_OF_DIRECTORY_SIGNATURE ||
+        i + END_OF_DIRECTORY_SIZE + read16(record + 20) != length) {
+      continue;
+    }
+
+    uint64_t entries = read16(record + 10);
+    uint64_t size = read32(record + 12);
+    uint64_t offset = read32(record + 16);
+
+    if (entries == 0xffff || size == 0xffffffff || offset == 0xffffffff) {
+      if (i < ZIP64_LOCATOR_SIZE) return false;
+
+      const unsigned char *locator = record - ZIP64_LOCATOR_SIZE;
+      if (read32(locator) != ZIP64_LOCATOR_SIGNATURE) return false;
+
+      uint64_t tailStart = archiveSize - length;
+      uint64_t recordOffset = read64(locator + 8);
+      if (recordOffset < tailStart ||
+          recordOffset - tailStart + ZIP64_END_OF_DIRECTORY_SIZE > i) {
+        return false;
+      }
+
+      const unsigned char *zip64 = tail + (recordOffset - tailStart);
+      if (read32(zip64) != ZIP64_END_OF_DIRECTORY_SIGNATURE) return false;
+
+      entries = read64(zip64 + 32);
+      size = read64(zip64 + 40);
+      offset = read64(zip64 + 48);
+    }
+
+    if (offset > archiveSize || size > archiveSize - offset) return false;
+
+    directory->offset = offset;
+    directory->size = size;
+    directory->entries = entries;
+    return true;
+  }
+
+  return false;
+}
+
+// Replaces the 32-bit fields saturated at 0xffffffff with their values from
+// the zip64 extra field.
+static bool readZip64Extra(const unsigned char *extra, size_t length,
+                           ArchiveEntry *entry) {
+  while (length >= 4) {
+    uint16_t id = read16(extra);
+    uint16_t size = read16(extra + 2);
+    if (size > length - 4) return false;
+
+    if (id == ZIP64_EXTRA_ID) {
+      const unsigned char *value = extra + 4;
+      const unsigned char *end = value + size;
+      uint64_t *fields[] = {&entry->size, &entry->compressedSize,
+                            &entry->localHeaderOffset};
+
+      for (uint64_t *field : fields) {
+        if (*field != 0xffffffff) continue;
+        if (end - value < 8) return false;
+
+        *field = read64(value);
+        value += 8;
+      }
+
+      return true;
+    }
+
+    extra += 4 + size;
+    length -= 4 + size;
+  }
+
+  return true;
+}
+
+static bool startsBefore(const ArchiveEntry &a, const ArchiveEntry &b) {
+  return a.localHeaderOffset < b.localHeaderOffset;
+}
+
+bool parseCentralDirectory(const unsigned char *data, size_t length,
+                           const CentralDirectory &directory,
+                           std::vector<ArchiveEntry> *entries) {
+  entries->clear();
+
+  // Bounded by what fits, the count may be anything in a corrupt archive.
+  uint64_t count = length / DIRECTORY_HEADER_SIZE;
+  entries->reserve((size_t)std::min(directory.entries, count));
+
+  size_t position = 0;
+
+  for (uint64_t i = 0; i < directory.entries; i++) {
+    const unsigned char *header = data + position;
+    if (length - position < DIRECTORY_HEADER_SIZE ||
+        read32(header) != DIRECTORY_HEADER_SIGNATURE) {
+      return false;
+    }
+
+    uint16_t madeBy = read16(header + 4);
+    uint16_t flags = read16(header + 8);
+    uint16_t nameLength = read16(header + 28);
+    uint16_t extraLength = read16(header + 30);
+    uint16_t commentLength = read16(header + 32);
+
+    size_t recordLength =
+        DIRECTORY_HEADER_SIZE + nameLength + extraLength + commentLength;
+    if (length - position < recordLength) return false;
+
+    // Encrypted entries cannot be extracted.
+    if (flags & 1) return false;
+
+    ArchiveEntry entry;
+    entry.name.assign((const char *)header + DIRECTORY_HEADER_SIZE,
+                      nameLength);
+    entry.method = read16(header + 10);
+    entry.crc32 = read32(header + 16);
+    entry.compressedSize = read32(header + 20);
+    entry.size = read32(header + 24);
+    entry.localHeaderOffset = read32(header + 42);
+    if (madeBy >> 8 == MADE_BY_UNIX) entry.mode = read32(header + 38) >> 16;
+
+    if (!readZip64Extra(header + DIRECTORY_HEADER_SIZE + nameLength,
+                        extraLength, &entry)) {
+      return false;
+    }
+
+    entries->push_back(entry);
+    position += recordLength;
+  }
+
+  std::sort(entries->begin(), entries->end(), startsBefore);
+
+  // Entries must not share data, which would also let a small archive
+  // expand into an arbitrary amount of output.
+  for (size_t i = 0; i < entries->size(); i++) {
+    const ArchiveEntry &entry = (*entries)[i];
+    uint64_t end = i + 1 < entries->size()
+                       ? (*entries)[i + 1].localHeaderOffset
+                       : directory.offset;
+
+    if (entry.localHeaderOffset > end ||
+        end - entry.localHeaderOffset < LOCAL_HEADER_SIZE ||
+        end - entry.localHeaderOffset - LOCAL_HEADER_SIZE <
+            entry.compressedSize) {
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,52 @@
+#ifndef ELECTRON_GLOBAL_ARCHIVE_HPP
+#define ELECTRON_GLOBAL_ARCHIVE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Reading of zip archives. Everything needed to extract an entry comes from
+// the central directory at the end of the archive, so it is fetched first and
+// the entries can then be extracted while the rest of the archive streams in.
+
+// Bytes at the end of an archive that are certain to hold the end of central
+// directory record: the record itself, the longest possible comment and a
+// zip64 locator.
+#define ARCHIVE_TAIL_SIZE (22 + 65535 + 20)
+
+#define ARCHIVE_METHOD_STORED 0
+#define ARCHIVE_METHOD_DEFLATED 8
+
+struct ArchiveEntry {
+  std::string name;
+  uint64_t localHeaderOffset = 0;
+  uint64_t compressedSize = 0;
+  uint64_t size = 0;
+  uint32_t crc32 = 0;
+  uint16_t method = 0;
+  // Unix mode, or 0 for archives made elsewhere.
+  uint32_t mode = 0;
+
+  bool isDirectory() const { return !name.empty() && name.back() == '/'; }
+  bool isSymlink() const { return (mode & 0170000) == 0120000; }
+};
+
+struct CentralDirectory {
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  uint64_t entries = 0;
+};
+
+// Locates the central directory from the last bytes of an archive of
+// `archiveSize` bytes, `tail` ending where the archive ends.
+bool findCentralDirectory(const unsigned char *tail, size_t length,
+                          uint64_t archiveSize, CentralDirectory *directory);
+
+// Parses the central directory, returning the entries sorted by the offset
+// of their data. Fails on encrypted, overlapping or truncated entries.
+bool parseCentralDirectory(const unsigned char *data, size_t length,
+                           const CentralDirectory &directory,
+                           std::vector<ArchiveEntry> *entries);
+
+#endif  // ELECTRON_GLOBAL_ARCHIVE_HPP
@@ -0,0 +1,87 @@
+#include "config.hpp"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <fstream>
+#include <map>
+
+#include "platform.hpp"
+
+static std::string trim(const std::string &text) {
+  size_t start = 0, end = text.size();
+  while (start < end && isspace((unsigned char)text[start])) start++;
+  while (end > start && isspace((unsigned char)text[end - 1])) end--;
+
+  return text.substr(start, end - start);
+}
+
+static const std::map<std::string, std::string> &readConfigFile() {
+  static std::map<std::string, std::string> values;
+  static bool loaded = false;
+
+  if (loaded) return values;
+  loaded = true;
+
+  const char *home = getenv(HOME_ENV);
+  if (!home) return values;
+
+  std::ifstream file(std::string(home) +
+                     PATH_SEPARATOR BIN_DIR PATH_SEPARATOR CONFIG_FILE);
+
+  std::string line;
+  while (std::getline(file, line)) {
+    line = trim(line);
+    if (line.empty() || line[0] == '#') continue;
+
+    size_t separator = line.find('=');
+    if (separator == std::string::npos) continue;
+
+    values[trim(line.substr(0, separator))] = trim(line.substr(separator + 1));
+  }
+
+  return values;
+}
+
+std::string getConfig(const char *key, const char *fallback) {
+  std::string name = CONFIG_ENV_PREFIX;
+  for (const char *c = key; *c; c++) name += (char)toupper((unsigned char)*c);
+
+  const char *env = getenv(name.c_str());
+  if (env) return env;
+
+  const std::map<std::string, std::string> &values = readConfigFile();
+  auto value = values.find(key);
+
+  return value != values.end() ? value->second : fallback;
+}
+
+long getConfigNumber(const char *key, long fallback) {
+  std::string value = getConfig(key);
+  if (value.empty()) return fallback;
+
+  char *end;
+  long number = strtol(value.c_str(), &end, 10);
+
+  return *end == '\0' && number >= 0 ? number : fallback;
+}
+
+static std::vector<std::string> splitList(const std::string &value) {
+  std::vector<std::string> items;
+  std::string item;
+
+  for (char c : value + " ") {
+    if (c == ',' || isspace((unsigned char)c)) {
+      if (!item.empty()) items.push_back(item);
+      item.clear();
+    } else {
+      item += c;
+    }
+  }
+
+  return items;
+}
+
+std::vector<std::string> getConfigList(const char *key, const char *fallback) {
+  std::vector<std::string> items = splitList(getConfig(key));
+  return items.empty() ? splitList(fallback) : items;
+}
@@ -0,0 +1,23 @@
+#ifndef ELECTRON_GLOBAL_CONFIG_HPP
+#define ELECTRON_GLOBAL_CONFIG_HPP
+
+#include <string>
+#include <vector>
+
+// Installer settings. A key is read from the ELECTRON_GLOBAL_<KEY>
+// environment variable first, then from `key = value` lines in
+// ~/.electron-global/config, where lines starting with # are comments.
+#define CONFIG_FILE "config"
+#define CONFIG_ENV_PREFIX "ELECTRON_GLOBAL_"
+
+std::string getConfig(const char *key, const char *fallback = "");
+
+// Reads a non-negative number, returning `fallback` if the key is missing or
+// holds anything else.
+long getConfigNumber(const char *key, long fallback);
+
+// Reads a list separated by commas or whitespace, `fallback` if the key is
+// missing or empty.
+std::vector<std::string> getConfigList(const char *key, const char *fallback);
+
+#endif  // ELECTRON_GLOBAL_CONFIG_HPP
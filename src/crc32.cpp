@@ -0,0 +1,182 @@
+#include "crc32.hpp"
+
+#include <string.h>
+
+// The implementation is linked from zip.o.
+#define MINIZ_HEADER_FILE_ONLY
+#include "lib/zip/src/miniz.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CRC32_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__GNUC__)
+#define CRC32_ARM
+#include <arm_acle.h>
+#ifdef __linux__
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+#endif
+
+// Kernels take and return the CRC inverted, as it is while being computed.
+typedef uint32_t (*Crc32Kernel)(uint32_t crc, const unsigned char *data,
+                                size_t length);
+
+static uint32_t crc32Portable(uint32_t crc, const unsigned char *data,
+                              size_t length) {
+  return ~(uint32_t)mz_crc32(~crc, data, length);
+}
+
+#ifdef CRC32_X86
+#define CRC32_FOLD_MIN 64
+
+// Folds four 16-byte lanes at a time with carry-less multiplication, then
+// the lanes into one and that into the CRC by Barrett reduction, following
+// Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ".
+// Takes at least CRC32_FOLD_MIN bytes, in multiples of 16.
+__attribute__((target("pclmul,sse4.1"))) static uint32_t crc32Fold(
+    uint32_t crc, const unsigned char *data, size_t length) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+  const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+  __m128i x1 = _mm_loadu_si128((const __m128i *)(data + 0x00));
+  __m128i x2 = _mm_loadu_si128((const __m128i *)(data + 0x10));
+  __m128i x3 = _mm_loadu_si128((const __m128i *)(data + 0x20));
+  __m128i x4 = _mm_loadu_si128((const __m128i *)(data + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+
+  data += 64;
+  length -= 64;
+
+  for (; length >= 64; data += 64, length -= 64) {
+    __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                       _mm_loadu_si128((const __m128i *)(data + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                       _mm_loadu_si128((const __m128i *)(data + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                       _mm_loadu_si128((const __m128i *)(data + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                       _mm_loadu_si128((const __m128i *)(data + 0x30)));
+  }
+
+  // Four lanes into one, then whatever 16 bytes are left.
+  const __m128i lanes[3] = {x2, x3, x4};
+  for (const __m128i &lane : lanes) {
+    __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, lane), x5);
+  }
+
+  for (; length >= 16; data += 16, length -= 16) {
+    __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                       _mm_loadu_si128((const __m128i *)data));
+  }
+
+  // 128 bits to 64.
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), k5k0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // 64 bits to 32.
+  x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), poly, 0x10);
+  x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, low32), poly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+__attribute__((target("pclmul,sse4.1"))) static uint32_t crc32Pclmul(
+    uint32_t crc, const unsigned char *data, size_t length) {
+  if (length >= CRC32_FOLD_MIN) {
+    size_t folded = length & ~(size_t)15;
+    crc = crc32Fold(crc, data, folded);
+    data += folded;
+    length -= folded;
+  }
+
+  return length > 0 ? crc32Portable(crc, data, length) : crc;
+}
+
+static bool hasPclmul() {
+  unsigned a, b, c, d;
+  return __get_cpuid(1, &a, &b, &c, &d) && (c & bit_PCLMUL) &&
+         (c & bit_SSE4_1);
+}
+#endif
+
+#ifdef CRC32_ARM
+#if defined(__ARM_FEATURE_CRC32)
+#define CRC32_ARM_TARGET
+#elif defined(__clang__)
+#define CRC32_ARM_TARGET __attribute__((target("crc")))
+#else
+#define CRC32_ARM_TARGET __attribute__((target("+crc")))
+#endif
+
+// Eight bytes per instruction once aligned.
+CRC32_ARM_TARGET static uint32_t crc32Arm(uint32_t crc,
+                                          const unsigned char *data,
+                                          size_t length) {
+  for (; length > 0 && ((uintptr_t)data & 7); data++, length--) {
+    crc = __crc32b(crc, *data);
+  }
+
+  for (; length >= 8; data += 8, length -= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc = __crc32d(crc, word);
+  }
+
+  for (; length > 0; data++, length--) crc = __crc32b(crc, *data);
+
+  return crc;
+}
+
+static bool hasArmCrc() {
+#if defined(__ARM_FEATURE_CRC32)
+  return true;
+#elif defined(__linux__)
+  return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+  return false;
+#endif
+}
+#endif
+
+static Crc32Kernel selectKernel() {
+#ifdef CRC32_X86
+  if (hasPclmul()) return crc32Pclmul;
+#endif
+#ifdef CRC32_ARM
+  if (hasArmCrc()) return crc32Arm;
+#endif
+
+  return crc32Portable;
+}
+
+static const Crc32Kernel crc32Kernel = selectKernel();
+
+uint32_t updateCrc32(uint32_t crc, const void *data, size_t length) {
+  return ~crc32Kernel(~crc, (const unsigned char *)data, length);
+}
@@ -0,0 +1,15 @@
+#ifndef ELECTRON_GLOBAL_CRC32_HPP
+#define ELECTRON_GLOBAL_CRC32_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRC32_INIT 0
+
+// Continues the CRC-32 of zip archives `crc` over `length` more bytes, so
+// entries can be checked as they are written. Runs on the carry-less
+// multiplication of x86 processors or the CRC instructions of ARMv8 ones
+// where the processor has them.
+uint32_t updateCrc32(uint32_t crc, const void *data, size_t length);
+
+#endif  // ELECTRON_GLOBAL_CRC32_HPP
@@ -0,0 +1,950 @@
+#include "download.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "config.hpp"
+#include "installer.hpp"
+#include "lib/filesystem.hpp"
+#include "output_file.hpp"
+#include "part_file.hpp"
+#include "trace.hpp"
+#include "write_behind.hpp"
+
+// Parallel connections used when the server supports ranges.
+#define DOWNLOAD_CONNECTIONS 4
+#define DOWNLOAD_MAX_CONNECTIONS 16
+// Size of the first request, which learns the size of the file, and of the
+// smallest range worth a connection of its own.
+#define DOWNLOAD_SEGMENT_SIZE (1 << 20)
+// Attempts of a range that fails without receiving anything, with the delay
+// between them doubling from DOWNLOAD_RETRY_DELAY up to
+// DOWNLOAD_MAX_RETRY_DELAY milliseconds.
+#define DOWNLOAD_RETRIES 6
+#define DOWNLOAD_RETRY_DELAY 500
+#define DOWNLOAD_MAX_RETRY_DELAY 16000
+// Seconds a connection may take to connect or stay below 1 KiB/s before it
+// is given up and retried.
+#define DOWNLOAD_STALL_TIME 20
+// Milliseconds between updates of the state file.
+#define DOWNLOAD_STATE_INTERVAL 1000
+// Bytes read back from the part at a time for the observer.
+#define DOWNLOAD_READ_SIZE (256 << 10)
+// A range that receives less than DOWNLOAD_HEDGE_FLOOR bytes per second over
+// DOWNLOAD_HEDGE_WINDOW milliseconds is also requested from another mirror.
+#define DOWNLOAD_HEDGE_FLOOR (64 << 10)
+#define DOWNLOAD_HEDGE_WINDOW 2000
+
+namespace fs = ghc::filesystem;
+
+static uint64_t nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Download;
+
+// Range waiting for a connection.
+struct PendingRange {
+  Range range;
+  // Failed attempts so far.
+  int attempt;
+  // Not started before this time in nowMs().
+  uint64_t notBefore;
+  // Index of the mirror it is requested from, or -1 for a probe sent to all
+  // of them.
+  int mirror;
+};
+
+struct Mirror {
+  std::string url;
+  // Effective URL once a response followed any redirects, so later ranges
+  // do not go through them again.
+  std::string effective;
+  // Failed a hedged request, so it gets no more of them.
+  bool failed = false;
+};
+
+// Request for one range, or for the whole file if the server turned out not
+// to support ranges.
+struct Transfer {
+  Download *download = nullptr;
+  CURL *curl = nullptr;
+  struct curl_slist *headers = nullptr;
+  Range range = {0, 0};
+  // Where the next byte received is written.
+  uint64_t offset = 0;
+  int attempt = 0;
+  int mirror = 0;
+  // Whether this is the first request, which sizes the download.
+  bool probe = false;
+  bool started = false;
+  uint64_t startTime = 0;
+  // Transfer racing this one for the same bytes after one of them stalled.
+  // Both write the same data, whichever finishes first cancels the other.
+  Transfer *partner = nullptr;
+  // Bytes of the range before this offset were counted as received.
+  uint64_t counted = 0;
+  // Offset at the start of the current throughput window, in nowMs().
+  uint64_t windowStart = 0;
+  uint64_t windowOffset = 0;
+  // Headers of the response.
+  std::string contentRange;
+  std::string etag;
+  std::string lastModified;
+  // Reason the write callback stopped the transfer.
+  CURLcode error = CURLE_OK;
+};
+
+struct Download {
+  CURLM *multi = nullptr;
+  OutputFile file;
+  // Whether the file is in memory, see downloadFile().
+  bool memory = false;
+  // Received data goes through it, so a slow disk does not hold up the
+  // connections. Flushed before the file is read back.
+  WriteBehind sink{&file};
+  std::string statePath;
+  // What is known about the file, also kept in the state file once the
+  // server turned out to support ranges. Its URL is the mirror the
+  // validators came from.
+  PartState state;
+  std::vector<Mirror> mirrors;
+  // Mirror of the state's validators, -1 if there are none yet.
+  int source = -1;
+  // Probe that answered first and sized the download.
+  Transfer *winner = nullptr;
+  DownloadProgress progress = nullptr;
+  uint64_t connections = 1;
+  bool sized = false;
+  bool ranged = false;
+  uint64_t received = 0;
+  std::deque<PendingRange> pending;
+  std::vector<std::unique_ptr<Transfer>> transfers;
+  uint64_t savedAt = 0;
+  DownloadObserver *observer = nullptr;
+  // Bytes passed to the observer, all from the start of the file.
+  uint64_t delivered = 0;
+  std::vector<char> buffer;
+};
+
+static uint64_t coveredBytes(const std::vector<Range> &ranges) {
+  uint64_t bytes = 0;
+  for (const Range &range : ranges) bytes += range.end - range.start;
+
+  return bytes;
+}
+
+// Reads the size of the whole file from a `bytes start-end/size` value.
+static uint64_t parseContentRangeSize(const std::string &value) {
+  size_t slash = value.rfind('/');
+  if (value.compare(0, 6, "bytes ") != 0 || slash == std::string::npos) {
+    return 0;
+  }
+
+  return strtoull(value.c_str() + slash + 1, nullptr, 10);
+}
+
+// Queues the parts of the file that are neither written nor in `probe`,
+// split so that they spread over all connections but no range is smaller
+// than DOWNLOAD_SEGMENT_SIZE.
+static void queueMissing(Download *download, Range probe) {
+  std::vector<Range> covered = download->state.done;
+  addRange(&covered, probe);
+
+  std::vector<Range> missing = missingRanges(covered, download->state.size);
+
+  uint64_t size = (coveredBytes(missing) + download->connections - 1) /
+                  download->connections;
+  if (size < DOWNLOAD_SEGMENT_SIZE) size = DOWNLOAD_SEGMENT_SIZE;
+
+  for (const Range &gap : missing) {
+    for (uint64_t offset = gap.start; offset < gap.end; offset += size) {
+      Range range = {offset, offset + size};
+      if (range.end > gap.end) range.end = gap.end;
+      download->pending.push_back({range, 0, 0, download->winner->mirror});
+    }
+  }
+}
+
+// Checks the response before the first byte of a transfer is written. The
+// first probe to answer decides which mirror and how the rest of the file is
+// fetched.
+static CURLcode startTransfer(Transfer *transfer) {
+  Download *download = transfer->download;
+  Mirror &mirror = download->mirrors[transfer->mirror];
+
+  long status = 0;
+  curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &status);
+
+  // Lost the race, see dropLosers().
+  if (transfer->probe && download->sized) return CURLE_ABORTED_BY_CALLBACK;
+
+  const char *url = nullptr;
+  if (status == 206 && mirror.effective.empty()) {
+    curl_easy_getinfo(transfer->curl, CURLINFO_EFFECTIVE_URL, &url);
+    if (url) mirror.effective = url;
+  }
+
+  // A 200 to a later range means the file changed since the probe, or that
+  // the mirror of a hedged request does not support ranges.
+  if (!transfer->probe) return status == 206 ? CURLE_OK : CURLE_RANGE_ERROR;
+
+  uint64_t total = parseContentRangeSize(transfer->contentRange);
+
+  download->sized = true;
+  download->winner = transfer;
+
+  // What the observer got from a file that changed cannot be taken back.
+  // Other mirrors have validators of their own, so that is left to the
+  // caller's checksum.
+  bool changed = transfer->mirror == download->source &&
+                 (transfer->etag != download->state.etag ||
+                  transfer->lastModified != download->state.lastModified);
+
+  download->source = transfer->mirror;
+  download->state.url = mirror.url;
+
+  if (status == 206 && total > 0) {
+    // Resuming, If-Range guarantees the part is still the same file.
+    if (download->state.size > 0 && download->state.size != total) {
+      return CURLE_RANGE_ERROR;
+    }
+
+    download->ranged = true;
+    download->state.size = total;
+    download->state.etag = transfer->etag;
+    download->state.lastModified = transfer->lastModified;
+
+    if (transfer->range.end > total) transfer->range.end = total;
+    queueMissing(download, transfer->range);
+  } else {
+    // The whole file comes with this response, either because the server
+    // ignores ranges, as for file:// mirrors, or because the file changed
+    // since the part was written.
+    if (download->delivered > 0 && changed) return CURLE_RANGE_ERROR;
+
+    curl_off_t length = -1;
+    curl_easy_getinfo(transfer->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+                      &length);
+
+    download->ranged = false;
+    download->state.size = length > 0 ? (uint64_t)length : 0;
+    download->state.etag = transfer->etag;
+    download->state.lastModified = transfer->lastModified;
+    download->state.done.clear();
+    download->received = 0;
+
+    transfer->range.start = transfer->offset = 0;
+    transfer->range.end =
+        download->state.size > 0 ? download->state.size : UINT64_MAX;
+  }
+
+  if (download->state.size > 0 &&
+      (!download->sink.flush() ||
+       !download->file.preallocate(download->state.size))) {
+    return CURLE_WRITE_ERROR;
+  }
+
+  return CURLE_OK;
+}
+
+static size_t onHeader(const char *contents, size_t size, size_t nmemb,
+                       void *userp) {
+  Transfer *transfer = (Transfer *)userp;
+  size_t length = size * nmemb;
+
+  // Headers of redirect responses must not stick.
+  if (length > 5 && memcmp(contents, "HTTP/", 5) == 0) {
+    transfer->contentRange.clear();
+    transfer->etag.clear();
+    transfer->lastModified.clear();
+  } else if (!readHeader(contents, length, "content-range",
+                         &transfer->contentRange) &&
+             !readHeader(contents, length, "etag", &transfer->etag)) {
+    readHeader(contents, length, "last-modified", &transfer->lastModified);
+  }
+
+  return length;
+}
+
+// End of the bytes written without a gap from the observer's position on.
+static uint64_t writtenEnd(const Download *download) {
+  std::vector<Range> written = download->state.done;
+  for (const std::unique_ptr<Transfer> &transfer : download->transfers) {
+    if (transfer->curl) {
+      addRange(&written, {transfer->range.start, transfer->offset});
+    }
+  }
+
+  for (const Range &range : written) {
+    if (range.start <= download->delivered && download->delivered < range.end) {
+      return range.end;
+    }
+  }
+
+  return download->delivered;
+}
+
+// Passes the observer what other connections wrote past its position, read
+// back from the part while it is still in the page cache.
+static CURLcode catchUp(Download *download) {
+  uint64_t end = writtenEnd(download);
+  if (download->delivered < end) {
+    if (!download->sink.flush()) return CURLE_WRITE_ERROR;
+    download->buffer.resize(DOWNLOAD_READ_SIZE);
+  }
+
+  while (download->delivered < end) {
+    size_t length = end - download->delivered < DOWNLOAD_READ_SIZE
+                        ? (size_t)(end - download->delivered)
+                        : DOWNLOAD_READ_SIZE;
+
+    if (!download->file.read(download->buffer.data(), length,
+                             download->delivered)) {
+      return CURLE_READ_ERROR;
+    }
+
+    if (!download->observer->received(download->buffer.data(), length)) {
+      return CURLE_ABORTED_BY_CALLBACK;
+    }
+
+    download->delivered += length;
+  }
+
+  return CURLE_OK;
+}
+
+static size_t onWrite(const char *contents, size_t size, size_t nmemb,
+                      void *userp) {
+  Transfer *transfer = (Transfer *)userp;
+  Download *download = transfer->download;
+  size_t length = size * nmemb;
+
+  if (!transfer->started) {
+    transfer->started = true;
+
+    transfer->error = startTransfer(transfer);
+    if (transfer->error != CURLE_OK) return 0;
+  }
+
+  // Whatever the server sends, a range must not overwrite its neighbors.
+  if (length > transfer->range.end - transfer->offset) {
+    transfer->error = CURLE_RANGE_ERROR;
+    return 0;
+  }
+
+  if (!download->sink.write(contents, length, transfer->offset)) {
+    transfer->error = CURLE_WRITE_ERROR;
+    return 0;
+  }
+
+  uint64_t offset = transfer->offset;
+  transfer->offset += length;
+
+  // Of a hedged pair, only bytes past both of them are new.
+  uint64_t ahead = transfer->counted;
+  if (transfer->partner && transfer->partner->offset > ahead) {
+    ahead = transfer->partner->offset;
+  }
+  if (transfer->offset > ahead) {
+    download->received += transfer->offset - (offset > ahead ? offset : ahead);
+  }
+
+  // Data continuing what the observer got is passed on as is.
+  if (download->observer && offset <= download->delivered &&
+      download->delivered < transfer->offset) {
+    size_t skip = (size_t)(download->delivered - offset);
+    if (!download->observer->received(contents + skip, length - skip)) {
+      transfer->error = CURLE_ABORTED_BY_CALLBACK;
+      return 0;
+    }
+
+    download->delivered = transfer->offset;
+
+    transfer->error = catchUp(download);
+    if (transfer->error != CURLE_OK) return 0;
+  }
+
+  if (download->progress) {
+    download->progress(download->received, download->state.size);
+  }
+
+  return length;
+}
+
+static Transfer *addTransfer(Download *download, const PendingRange &pending,
+                             int mirror) {
+  CURL *curl = curl_easy_init();
+  if (!curl) return nullptr;
+
+  std::unique_ptr<Transfer> transfer(new Transfer());
+  transfer->download = download;
+  transfer->curl = curl;
+  transfer->range = pending.range;
+  transfer->offset = pending.range.start;
+  transfer->attempt = pending.attempt;
+  transfer->mirror = mirror;
+  transfer->probe = !download->sized;
+  transfer->startTime = traceNow();
+  transfer->windowStart = nowMs();
+  transfer->windowOffset = transfer->offset;
+
+  // Ranges of a file that changed in between must not be mixed. Weak ETags
+  // cannot be used for that, and the validators of one mirror mean nothing
+  // to another.
+  const PartState &state = download->state;
+  if (mirror != download->source) {
+    // No validators.
+  } else if (!state.etag.empty() && state.etag.compare(0, 2, "W/") != 0) {
+    transfer->headers = curl_slist_append(
+        nullptr, ("If-Range: " + state.etag).c_str());
+  } else if (!state.lastModified.empty()) {
+    transfer->headers = curl_slist_append(
+        nullptr, ("If-Range: " + state.lastModified).c_str());
+  }
+
+  const Mirror &source = download->mirrors[mirror];
+  const std::string &url =
+      source.effective.empty() ? source.url : source.effective;
+
+  char bytes[48];
+  snprintf(bytes, sizeof(bytes), "%" PRIu64 "-%" PRIu64, pending.range.start,
+           pending.range.end - 1);
+
+  setTransferDefaults(curl);
+  // Ranges are offsets into the stored file, so the body must arrive as is.
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, nullptr);
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  // Files are copied whole, libcurl has no way to tell whether it honored
+  // the range.
+  if (url.compare(0, 7, "file://") != 0) {
+    curl_easy_setopt(curl, CURLOPT_RANGE, bytes);
+  }
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->headers);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, true);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, DOWNLOAD_STALL_TIME);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1024);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, DOWNLOAD_STALL_TIME);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, onHeader);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, transfer.get());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, onWrite);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer.get());
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer.get());
+
+  if (curl_multi_add_handle(download->multi, curl) != CURLM_OK) {
+    curl_easy_cleanup(curl);
+    curl_slist_free_all(transfer->headers);
+    return nullptr;
+  }
+
+  download->transfers.push_back(std::move(transfer));
+  return download->transfers.back().get();
+}
+
+static void removeTransfer(Transfer *transfer) {
+  curl_multi_remove_handle(transfer->download->multi, transfer->curl);
+  curl_easy_cleanup(transfer->curl);
+  curl_slist_free_all(transfer->headers);
+  transfer->curl = nullptr;
+  transfer->headers = nullptr;
+
+  // The bytes it wrote count for the range whoever finishes it.
+  Transfer *partner = transfer->partner;
+  if (partner) {
+    if (partner->counted < transfer->offset) {
+      partner->counted = transfer->offset;
+    }
+    partner->partner = nullptr;
+  }
+  transfer->partner = nullptr;
+}
+
+static size_t activeTransfers(const Download *download) {
+  size_t active = 0;
+  for (const std::unique_ptr<Transfer> &transfer : download->transfers) {
+    if (transfer->curl) active++;
+  }
+
+  return active;
+}
+
+// Whether a failed transfer is worth another attempt.
+static bool isTransient(CURLcode result, long status) {
+  switch (result) {
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_HTTP2:
+      return true;
+    case CURLE_HTTP_RETURNED_ERROR:
+      return status == 408 || status == 429 || status >= 500;
+    default:
+      return false;
+  }
+}
+
+// Records the bytes written by `transfer` in the state.
+static void recordTransfer(Download *download, const Transfer *transfer) {
+  if (!download->ranged) return;
+
+  addRange(&download->state.done, {transfer->range.start, transfer->offset});
+}
+
+// Saves which bytes are written, including those of running transfers. Only
+// ranged downloads can be resumed.
+static void saveState(Download *download) {
+  download->savedAt = nowMs();
+
+  if (!download->ranged || download->memory) return;
+
+  PartState state = download->state;
+  for (const std::unique_ptr<Transfer> &transfer : download->transfers) {
+    if (transfer->curl) {
+      addRange(&state.done, {transfer->range.start, transfer->offset});
+    }
+  }
+
+  // Bytes still on their way to the file would be lost to a crash. Buffers
+  // still filling are started now, so the next save includes them.
+  download->sink.push();
+  for (const Range &range : download->sink.pending()) {
+    removeRange(&state.done, range);
+  }
+
+  writePartState(download->statePath.c_str(), state);
+}
+
+// Cancels the probes that lost the race to the first mirror to answer.
+static void dropLosers(Download *download) {
+  for (const std::unique_ptr<Transfer> &transfer : download->transfers) {
+    if (transfer->curl && transfer->probe &&
+        transfer.get() != download->winner) {
+      removeTransfer(transfer.get());
+    }
+  }
+}
+
+// Next mirror after `mirror` that may get a hedged request, or -1. Whole
+// file copies cannot take over a range.
+static int hedgeMirror(const Download *download, int mirror) {
+  size_t count = download->mirrors.size();
+  for (size_t i = 1; i < count; i++) {
+    size_t candidate = (mirror + i) % count;
+    const Mirror &next = download->mirrors[candidate];
+    if (!next.failed && next.url.compare(0, 7, "file://") != 0) {
+      return (int)candidate;
+    }
+  }
+
+  return -1;
+}
+
+// Requests the rest of every range that stayed below DOWNLOAD_HEDGE_FLOOR
+// for a whole window from another mirror as well.
+static bool hedgeStalled(Download *download) {
+  if (!download->ranged) return true;
+
+  uint64_t now = nowMs();
+
+  // Hedged requests add to the list being iterated.
+  size_t count = download->transfers.size();
+  for (size_t i = 0; i < count; i++) {
+    Transfer *transfer = download->transfers[i].get();
+    if (!transfer->curl || transfer->partner ||
+        now < transfer->windowStart + DOWNLOAD_HEDGE_WINDOW) {
+      continue;
+    }
+
+    uint64_t rate = (transfer->offset - transfer->windowOffset) * 1000 /
+                    (now - transfer->windowStart);
+    transfer->windowStart = now;
+    transfer->windowOffset = transfer->offset;
+
+    int mirror = hedgeMirror(download, transfer->mirror);
+    if (rate >= DOWNLOAD_HEDGE_FLOOR || mirror < 0 ||
+        transfer->offset == transfer->range.end) {
+      continue;
+    }
+
+    PendingRange rest = {{transfer->offset, transfer->range.end}, 0, 0,
+                         mirror};
+    Transfer *hedge = addTransfer(download, rest, mirror);
+    if (!hedge) return false;
+
+    hedge->partner = transfer;
+    transfer->partner = hedge;
+
+    uint64_t time = traceNow();
+    traceEvent("hedge", time, time, download->mirrors[mirror].url.c_str());
+  }
+
+  return true;
+}
+
+// Handles a finished transfer, queueing what is left of its range again if
+// the failure looks transient. Returns the error that fails the download.
+static CURLcode finishTransfer(Transfer *transfer, CURLcode result) {
+  Download *download = transfer->download;
+  const std::string &url = download->mirrors[transfer->mirror].url;
+
+  // A probe that lost the race, as opposed to one that failed, wrote
+  // nothing.
+  if (transfer->probe && download->sized &&
+      transfer != download->winner) {
+    removeTransfer(transfer);
+    return CURLE_OK;
+  }
+
+  long status = 0;
+  curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &status);
+
+  if (transfer->error != CURLE_OK) {
+    result = transfer->error;
+  } else if (result == CURLE_OK && transfer->offset != transfer->range.end &&
+             (download->ranged || download->state.size > 0)) {
+    result = CURLE_PARTIAL_FILE;
+  }
+
+  char detail[64];
+  snprintf(detail, sizeof(detail), "bytes %" PRIu64 "-%" PRIu64,
+           transfer->range.start, transfer->offset);
+
+  if (transfer->probe) {
+    traceTransfer(transfer->curl, url.c_str(), transfer->startTime);
+  }
+  traceEvent("download range", transfer->startTime, traceNow(), detail);
+
+  Transfer *partner = transfer->partner;
+
+  removeTransfer(transfer);
+  recordTransfer(download, transfer);
+
+  // Of a hedged pair, the first to finish wins and a failure leaves the
+  // range to the other.
+  if (partner && result == CURLE_OK) {
+    recordTransfer(download, partner);
+    removeTransfer(partner);
+    return CURLE_OK;
+  } else if (partner) {
+    if (transfer->mirror != download->winner->mirror) {
+      download->mirrors[transfer->mirror].failed = true;
+    }
+    return CURLE_OK;
+  }
+
+  // The other probes are still racing.
+  if (!download->sized) {
+    for (const std::unique_ptr<Transfer> &other : download->transfers) {
+      if (other->curl && other->probe) return CURLE_OK;
+    }
+  }
+
+  if (result == CURLE_OK || !isTransient(result, status)) return result;
+
+  // A range that made progress starts counting its attempts again.
+  int attempt = transfer->offset > transfer->range.start
+                    ? 1
+                    : transfer->attempt + 1;
+  if (attempt >= DOWNLOAD_RETRIES) return result;
+
+  Range remainder = {transfer->offset, transfer->range.end};
+  int mirror = transfer->mirror;
+  if (!download->ranged) {
+    // The probe is sent again. A single stream can only start over.
+    download->received -= transfer->offset - transfer->range.start;
+    download->sized = false;
+    download->winner = nullptr;
+    mirror = -1;
+    if (transfer->started) remainder = {0, DOWNLOAD_SEGMENT_SIZE};
+  }
+
+  uint64_t delay = (uint64_t)DOWNLOAD_RETRY_DELAY << (attempt - 1);
+  if (delay > DOWNLOAD_MAX_RETRY_DELAY) delay = DOWNLOAD_MAX_RETRY_DELAY;
+  // Jitter keeps parallel ranges from retrying in lockstep.
+  delay += (uint64_t)rand() % (delay / 4 + 1);
+
+  download->pending.push_back({remainder, attempt, nowMs() + delay, mirror});
+
+  return CURLE_OK;
+}
+
+// Loads the state of an earlier attempt at one of the mirrors, if its part
+// is intact.
+static bool loadState(Download *download, const std::string &partPath) {
+  PartState state;
+  if (!readPartState(download->statePath.c_str(), &state) ||
+      (state.etag.empty() && state.lastModified.empty())) {
+    return false;
+  }
+
+  for (size_t i = 0; i < download->mirrors.size(); i++) {
+    if (download->mirrors[i].url == state.url) download->source = (int)i;
+  }
+  if (download->source < 0) return false;
+
+  std::error_code ec;
+  if (fs::file_size(partPath, ec) != state.size || ec) return false;
+
+  download->state = state;
+  download->received = coveredBytes(state.done);
+
+  return true;
+}
+
+CURLcode downloadFile(const std::vector<std::string> &urls, const char *path,
+                      DownloadProgress progress, DownloadObserver *observer,
+                      bool inMemory) {
+  Download download;
+  download.progress = progress;
+  download.observer = observer;
+  download.statePath = std::string(path) + PART_STATE_SUFFIX;
+
+  long connections =
+      getConfigNumber("download_connections", DOWNLOAD_CONNECTIONS);
+  if (connections < 1) connections = 1;
+  if (connections > DOWNLOAD_MAX_CONNECTIONS) {
+    connections = DOWNLOAD_MAX_CONNECTIONS;
+  }
+  download.connections = (uint64_t)connections;
+
+  for (const std::string &url : urls) {
+    Mirror mirror;
+    mirror.url = url;
+    download.mirrors.push_back(mirror);
+  }
+  if (download.mirrors.empty()) return CURLE_URL_MALFORMAT;
+
+  std::string partPath = std::string(path) + PART_SUFFIX;
+  bool resume = loadState(&download, partPath);
+  if (!resume) download.source = -1;
+
+  download.memory =
+      inMemory && !resume &&
+      download.file.openMemory(fs::path(path).filename().string().c_str());
+  if (!download.memory && !download.file.open(partPath.c_str(), resume)) {
+    return CURLE_WRITE_ERROR;
+  }
+
+  download.multi = curl_multi_init();
+  if (!download.multi) return CURLE_FAILED_INIT;
+
+  // Parallel ranges only help as separate TCP connections, not as HTTP/2
+  // streams sharing one.
+  curl_multi_setopt(download.multi, CURLMOPT_PIPELINING, CURLPIPE_NOTHING);
+
+  // The probe asks for the first missing bytes.
+  std::vector<Range> missing =
+      resume ? missingRanges(download.state.done, download.state.size)
+             : std::vector<Range>(1, Range{0, DOWNLOAD_SEGMENT_SIZE});
+
+  if (!missing.empty()) {
+    Range probe = missing[0];
+    if (probe.end - probe.start > DOWNLOAD_SEGMENT_SIZE) {
+      probe.end = probe.start + DOWNLOAD_SEGMENT_SIZE;
+    }
+    download.pending.push_back({probe, 0, 0, -1});
+  }
+
+  if (progress) progress(download.received, download.state.size);
+
+  // The observer starts with what the part already holds.
+  CURLcode result = observer ? catchUp(&download) : CURLE_OK;
+  size_t active = 0;
+
+  while ((active > 0 || !download.pending.empty()) && result == CURLE_OK) {
+    // Ranges are queued once the probe sized the file and start whenever a
+    // connection frees up. The probe goes to every mirror at once.
+    uint64_t now = nowMs();
+    uint64_t wait = 1000;
+
+    for (size_t i = 0; i < download.pending.size() &&
+                       active < (download.sized ? download.connections : 1);) {
+      PendingRange pending = download.pending[i];
+      if (pending.notBefore > now) {
+        if (pending.notBefore - now < wait) wait = pending.notBefore - now;
+        i++;
+        continue;
+      }
+
+      for (size_t mirror = 0; mirror < download.mirrors.size(); mirror++) {
+        if (pending.mirror >= 0 && (int)mirror != pending.mirror) continue;
+
+        if (!addTransfer(&download, pending, (int)mirror)) {
+          result = CURLE_FAILED_INIT;
+          break;
+        }
+      }
+
+      download.pending.erase(download.pending.begin() + i);
+      active = activeTransfers(&download);
+    }
+
+    if (result == CURLE_OK && !hedgeStalled(&download)) {
+      result = CURLE_FAILED_INIT;
+    }
+
+    active = activeTransfers(&download);
+    if (result != CURLE_OK) break;
+
+    if (active == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+      continue;
+    }
+
+    int running = 0;
+    if (curl_multi_perform(download.multi, &running) != CURLM_OK) {
+      result = CURLE_RECV_ERROR;
+      break;
+    }
+
+    int queued;
+    CURLMsg *message;
+    while (result == CURLE_OK &&
+           (message = curl_multi_info_read(download.multi, &queued))) {
+      if (message->msg != CURLMSG_DONE) continue;
+
+      Transfer *transfer = nullptr;
+      curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &transfer);
+
+      result = finishTransfer(transfer, message->data.result);
+    }
+
+    if (download.sized) dropLosers(&download);
+    active = activeTransfers(&download);
+
+    if (nowMs() - download.savedAt >= DOWNLOAD_STATE_INTERVAL) {
+      saveState(&download);
+    }
+
+    if (active > 0 && result == CURLE_OK) {
+      curl_multi_wait(download.multi, nullptr, 0, (int)wait, nullptr);
+    }
+  }
+
+  for (const std::unique_ptr<Transfer> &transfer : download.transfers) {
+    if (!transfer->curl) continue;
+
+    recordTransfer(&download, transfer.get());
+    removeTransfer(transfer.get());
+  }
+
+  curl_multi_cleanup(download.multi);
+
+  if (result == CURLE_OK && observer &&
+      download.delivered < download.state.size) {
+    result = CURLE_PARTIAL_FILE;
+  }
+
+  bool flushed = download.sink.flush();
+  if ((!download.file.close() || !flushed) && result == CURLE_OK) {
+    result = CURLE_WRITE_ERROR;
+  }
+
+  // Nothing of it outlives the memory file.
+  if (download.memory) return result;
+
+  std::error_code ec;
+
+  if (result == CURLE_OK) {
+    fs::remove(download.statePath, ec);
+    fs::rename(partPath, path, ec);
+    if (ec) result = CURLE_WRITE_ERROR;
+  } else if (download.ranged && result != CURLE_RANGE_ERROR) {
+    // Kept for the next attempt, unless the server sent something else than
+    // the part holds.
+    saveState(&download);
+  } else if (!resume || download.sized) {
+    // A part that could not even be probed again is left as it was.
+    fs::remove(download.statePath, ec);
+    fs::remove(partPath, ec);
+  }
+
+  return result;
+}
+
+// Response to fetchRange().
+struct RangeFetch {
+  CURL *curl = nullptr;
+  std::string *data = nullptr;
+  std::string contentRange;
+};
+
+static size_t onRangeHeader(const char *contents, size_t size, size_t nmemb,
+                            void *userp) {
+  RangeFetch *fetch = (RangeFetch *)userp;
+  size_t length = size * nmemb;
+
+  if (length > 5 && memcmp(contents, "HTTP/", 5) == 0) {
+    fetch->contentRange.clear();
+  } else {
+    readHeader(contents, length, "content-range", &fetch->contentRange);
+  }
+
+  return length;
+}
+
+static size_t onRangeWrite(const char *contents, size_t size, size_t nmemb,
+                           void *userp) {
+  RangeFetch *fetch = (RangeFetch *)userp;
+
+  // The whole file is not wanted.
+  long status = 0;
+  curl_easy_getinfo(fetch->curl, CURLINFO_RESPONSE_CODE, &status);
+  if (status != 206) return 0;
+
+  fetch->data->append(contents, size * nmemb);
+  return size * nmemb;
+}
+
+CURLcode fetchRange(const std::string &url, const char *range,
+                    std::string *data, uint64_t *size) {
+  CURL *curl = curl_easy_init();
+  if (!curl) return CURLE_FAILED_INIT;
+
+  RangeFetch fetch;
+  fetch.curl = curl;
+  fetch.data = data;
+  data->clear();
+
+  setTransferDefaults(curl);
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, nullptr);
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_RANGE, range);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, true);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, DOWNLOAD_STALL_TIME);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1024);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, DOWNLOAD_STALL_TIME);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, onRangeHeader);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &fetch);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, onRangeWrite);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &fetch);
+
+  uint64_t start = traceNow();
+  CURLcode result = curl_easy_perform(curl);
+  traceTransfer(curl, url.c_str(), start);
+
+  long status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+  curl_easy_cleanup(curl);
+
+  if (result == CURLE_OK || result == CURLE_WRITE_ERROR) {
+    *size = parseContentRangeSize(fetch.contentRange);
+    if (status != 206 || *size == 0) return CURLE_RANGE_ERROR;
+  }
+
+  return result;
+}
@@ -0,0 +1,68 @@
+#ifndef ELECTRON_GLOBAL_DOWNLOAD_HPP
+#define ELECTRON_GLOBAL_DOWNLOAD_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+
+// Called from the downloading thread whenever data arrives. `total` is 0
+// while the size is unknown.
+typedef void (*DownloadProgress)(uint64_t received, uint64_t total);
+
+// Consumes a download as it arrives, in order and exactly once, from the
+// downloading thread.
+class DownloadObserver {
+ public:
+  virtual ~DownloadObserver() {}
+
+  // Returns false to fail the download.
+  virtual bool received(const char *data, size_t length) = 0;
+};
+
+// Downloads the file at `urls`, mirrors of the same file, into the file at
+// `path`. The first request asks for a small range to learn the size and
+// whether the server honors ranges. It is sent to every mirror at once and
+// the first to answer serves the download. If it honors ranges, the rest of
+// the file is split into ranges fetched over `download_connections` parallel
+// connections and written in place into a preallocated file; otherwise the
+// response is stored as a single stream, as for file:// mirrors.
+//
+// A range that stalls below a throughput floor is also requested from the
+// next mirror, and whichever of the two finishes first wins. As mirrors do
+// not share validators, only the caller's checksum tells whether they serve
+// the same file.
+//
+// Data is written to `<path>.part` and renamed to `path` once complete. A
+// ranged download that is cancelled, crashes or fails keeps its part and
+// resumes from where it stopped the next time one of the same URLs is
+// downloaded, see part_file.hpp. Ranges that fail on transient errors are
+// retried with exponential backoff.
+//
+// If an `observer` is given, it is passed the file from its first byte on.
+// Bytes arriving in order are passed on straight from the network, bytes
+// that arrive ahead of a gap are read back from the part once the gap is
+// filled.
+//
+// With `inMemory`, for an observer that needs nothing but what it is passed,
+// the part is an anonymous memory file that is gone once the download
+// returns, so nothing is written to disk and nothing is left to resume. It
+// falls back to `<path>.part` where there are no memory files, and when an
+// earlier attempt left a part to resume from.
+//
+// Returns CURLE_OK or the error that failed the download, which is left to
+// the caller to report. CURLE_ABORTED_BY_CALLBACK means the observer failed.
+CURLcode downloadFile(const std::vector<std::string> &urls, const char *path,
+                      DownloadProgress progress,
+                      DownloadObserver *observer = nullptr,
+                      bool inMemory = false);
+
+// Fetches the bytes of `url` in `range`, e.g. "-1000" for the last 1000
+// bytes, into `data` and the size of the whole file into `size`. Fails with
+// CURLE_RANGE_ERROR if the server does not support ranges.
+CURLcode fetchRange(const std::string &url, const char *range,
+                    std::string *data, uint64_t *size);
+
+#endif  // ELECTRON_GLOBAL_DOWNLOAD_HPP
@@ -0,0 +1,554 @@
+#include "extract.hpp"
+
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <set>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "crc32.hpp"
+#include "inflate.hpp"
+#include "output_file.hpp"
+
+#define LOCAL_HEADER_SIGNATURE 0x04034b50
+#define LOCAL_HEADER_SIZE 30
+
+namespace fs = ghc::filesystem;
+
+static uint16_t read16(const unsigned char *data) {
+  return (uint16_t)(data[0] | data[1] << 8);
+}
+
+static uint32_t read32(const unsigned char *data) {
+  return (uint32_t)read16(data) | (uint32_t)read16(data + 2) << 16;
+}
+
+// Maps the name of an entry to a path below `root`. Fails for names that
+// would escape it.
+static bool entryPath(const fs::path &root, const std::string &name,
+                      fs::path *path) {
+  if (name.empty() || name[0] == '/' || name.find('\\') != std::string::npos) {
+    return false;
+  }
+
+#ifdef _WIN32
+  // Drive letters and alternate data streams.
+  if (name.find(':') != std::string::npos) return false;
+#endif
+
+  fs::path result = root;
+
+  for (size_t start = 0; start < name.size();) {
+    size_t end = name.find('/', start);
+    if (end == std::string::npos) end = name.size();
+
+    std::string part = name.substr(start, end - start);
+    if (part == "..") return false;
+    if (!part.empty() && part != ".") result /= part;
+
+    start = end + 1;
+  }
+
+  *path = result;
+  return true;
+}
+
+// Writes one entry from its compressed data, passed in order. Files are
+// created in `directory` if it is open, by their path otherwise.
+class EntryWriter {
+ public:
+  EntryWriter(const ArchiveEntry &entry, const fs::path &path, int directory)
+      : entry_(entry), path_(path), directory_(directory) {}
+
+  bool begin();
+  bool write(const unsigned char *data, size_t length, bool last);
+  // Whether writeWhole() inflates the entry into memory, taking its size.
+  bool inflatesWhole() const;
+  // Writes the entry from all of its compressed data at once.
+  bool writeWhole(const unsigned char *data, size_t length);
+  bool end();
+
+  const std::string &error() const { return error_; }
+  bool isSymlink() const { return symlink_; }
+  const std::string &target() const { return target_; }
+
+ private:
+  EntryWriter(const EntryWriter &);
+  EntryWriter &operator=(const EntryWriter &);
+
+  bool fail(const std::string &message);
+  bool open();
+  bool output(const unsigned char *data, size_t length);
+
+  const ArchiveEntry &entry_;
+  fs::path path_;
+  int directory_;
+  std::string error_;
+
+  OutputFile file_;
+  uint64_t written_ = 0;
+  uint32_t crc32_ = CRC32_INIT;
+  bool symlink_ = false;
+  std::string target_;
+
+  const InflateBackend &backend_ = inflateBackend();
+  std::unique_ptr<Inflater> inflater_;
+  bool inflated_ = false;
+};
+
+bool EntryWriter::fail(const std::string &message) {
+  if (error_.empty()) error_ = message;
+  file_.close();
+
+  return false;
+}
+
+bool EntryWriter::begin() {
+  // Directories are created up front.
+  if (entry_.isDirectory()) return true;
+
+  if (entry_.method != ARCHIVE_METHOD_STORED &&
+      entry_.method != ARCHIVE_METHOD_DEFLATED) {
+    return fail("Unsupported compression of " + entry_.name);
+  }
+
+#ifndef _WIN32
+  // The target is collected and linked in finish().
+  if (entry_.isSymlink()) {
+    symlink_ = true;
+    return true;
+  }
+#endif
+
+  if (!open()) return fail("Could not create " + path_.string());
+
+  if (entry_.size >= EXTRACT_PREALLOCATE_MIN &&
+      !file_.preallocate(entry_.size)) {
+    return fail("Could not write " + path_.string());
+  }
+
+  return true;
+}
+
+// Creates the file with its permissions, so they need no second call.
+bool EntryWriter::open() {
+  int mode = entry_.mode & 0777 ? (int)(entry_.mode & 0777) : 0644;
+
+#ifndef _WIN32
+  if (directory_ >= 0) {
+    return file_.openAt(directory_, path_.filename().string().c_str(), mode);
+  }
+#endif
+
+  return file_.open(path_.string().c_str(), false, mode);
+}
+
+bool EntryWriter::write(const unsigned char *data, size_t length, bool last) {
+  if (entry_.isDirectory()) return true;
+
+  if (entry_.method == ARCHIVE_METHOD_STORED) return output(data, length);
+
+  if (!inflater_) inflater_.reset(backend_.stream());
+
+  if (!inflater_->inflate(data, length, last,
+                          [this](const unsigned char *out, size_t size) {
+                            return output(out, size);
+                          })) {
+    return fail("Corrupt archive entry " + entry_.name);
+  }
+
+  inflated_ = inflater_->done();
+  return true;
+}
+
+bool EntryWriter::inflatesWhole() const {
+  return !entry_.isDirectory() && entry_.method == ARCHIVE_METHOD_DEFLATED &&
+         backend_.whole && entry_.size <= INFLATE_WHOLE_LIMIT;
+}
+
+bool EntryWriter::writeWhole(const unsigned char *data, size_t length) {
+  if (!inflatesWhole()) return write(data, length, true);
+
+  size_t size = (size_t)entry_.size;
+  std::unique_ptr<unsigned char[]> inflated(new unsigned char[size]);
+  if (!backend_.whole(data, length, inflated.get(), size)) {
+    return fail("Corrupt archive entry " + entry_.name);
+  }
+
+  inflated_ = true;
+  return output(inflated.get(), size);
+}
+
+bool EntryWriter::end() {
+  if (entry_.isDirectory()) return true;
+
+  if ((entry_.method == ARCHIVE_METHOD_DEFLATED && !inflated_) ||
+      written_ != entry_.size || crc32_ != entry_.crc32) {
+    return fail("Corrupt archive entry " + entry_.name);
+  }
+
+  if (symlink_) return true;
+
+  if (!file_.close()) return fail("Could not write " + path_.string());
+
+  return true;
+}
+
+bool EntryWriter::output(const unsigned char *data, size_t length) {
+  // Also bounds what a corrupt entry can write.
+  if (length > entry_.size - written_) {
+    return fail("Corrupt archive entry " + entry_.name);
+  }
+
+  crc32_ = updateCrc32(crc32_, data, length);
+
+  if (symlink_) {
+    target_.append((const char *)data, length);
+  } else if (!file_.write((const char *)data, length, written_)) {
+    return fail("Could not write " + path_.string());
+  }
+
+  written_ += length;
+  return true;
+}
+
+ArchiveExtractor::ArchiveExtractor(const fs::path &root,
+                                   const std::vector<ArchiveEntry> &entries,
+                                   ExtractProgress progress)
+    : root_(root), entries_(entries), progress_(progress), failed_(false) {}
+
+ArchiveExtractor::~ArchiveExtractor() {
+  cancel();
+
+#ifndef _WIN32
+  for (int descriptor : descriptors_) close(descriptor);
+#endif
+}
+
+void ArchiveExtractor::cancel() {
+  failed_ = true;
+  pool_.reset();
+}
+
+bool ArchiveExtractor::fail(const std::string &message) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (error_.empty()) error_ = message;
+
+  failed_ = true;
+  released_.notify_all();
+
+  return false;
+}
+
+std::string ArchiveExtractor::error() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return error_;
+}
+
+// Checks the paths of all entries and creates their directories, so nothing
+// is written unless every path is valid and the pool does not race to
+// create the same directories.
+bool ArchiveExtractor::prepare() {
+  if (prepared_) return true;
+  prepared_ = true;
+
+  std::set<std::string> created;
+  std::map<std::string, int> opened;
+
+  for (const ArchiveEntry &entry : entries_) {
+    fs::path path;
+    if (!entryPath(root_, entry.name, &path)) {
+      return fail("Invalid path in archive: " + entry.name);
+    }
+
+    paths_.push_back(path);
+    total_ += entry.size;
+
+    fs::path directory = entry.isDirectory() ? path : path.parent_path();
+    if (created.insert(directory.string()).second) {
+      std::error_code ec;
+      fs::create_directories(directory, ec);
+      if (ec) return fail("Could not create " + directory.string());
+    }
+
+    // Files are created relative to their directory, which spares the
+    // kernel looking up the whole path for each of them.
+    int descriptor = -1;
+#ifndef _WIN32
+    if (!entry.isDirectory()) {
+      std::map<std::string, int>::iterator found =
+          opened.find(directory.string());
+
+      if (found != opened.end()) {
+        descriptor = found->second;
+      } else if (descriptors_.size() < EXTRACT_OPEN_DIRECTORIES) {
+        descriptor = ::open(directory.string().c_str(),
+                          O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (descriptor >= 0) descriptors_.push_back(descriptor);
+        opened[directory.string()] = descriptor;
+      }
+    }
+#endif
+    directories_.push_back(descriptor);
+  }
+
+  return true;
+}
+
+bool ArchiveExtractor::received(const char *data, size_t length) {
+  if (failed_ || !prepare()) return false;
+
+  const unsigned char *bytes = (const unsigned char *)data;
+
+  while (length > 0 && index_ < entries_.size()) {
+    const ArchiveEntry &entry = entries_[index_];
+    size_t chunk = length;
+
+    switch (state_) {
+      case SKIP:
+        // Whatever lies between entries, such as data descriptors.
+        if (position_ < entry.localHeaderOffset) {
+          if (chunk > entry.localHeaderOffset - position_) {
+            chunk = (size_t)(entry.localHeaderOffset - position_);
+          }
+          break;
+        }
+
+        state_ = HEADER;
+        header_.clear();
+        chunk = 0;
+        break;
+
+      case HEADER:
+        if (chunk > LOCAL_HEADER_SIZE - header_.size()) {
+          chunk = LOCAL_HEADER_SIZE - header_.size();
+        }
+        header_.append((const char *)bytes, chunk);
+
+        if (header_.size() == LOCAL_HEADER_SIZE) {
+          const unsigned char *header = (const unsigned char *)header_.data();
+          if (read32(header) != LOCAL_HEADER_SIGNATURE) {
+            return fail("Invalid local header for " + entry.name);
+          }
+
+          // The name and extra field may differ from the central directory,
+          // which is what counts.
+          skip_ = (uint64_t)read16(header + 26) + read16(header + 28);
+          state_ = NAME;
+        }
+        break;
+
+      case NAME:
+        if (chunk > skip_) chunk = (size_t)skip_;
+        skip_ -= chunk;
+
+        if (skip_ == 0) {
+          if (!beginEntry()) return false;
+          state_ = DATA;
+        }
+        break;
+
+      case DATA:
+        if (chunk > entry.compressedSize - consumed_) {
+          chunk = (size_t)(entry.compressedSize - consumed_);
+        }
+        consumed_ += chunk;
+
+        if (writer_ && !writer_->write(bytes, chunk,
+                                       consumed_ == entry.compressedSize)) {
+          return fail(writer_->error());
+        } else if (buffer_) {
+          buffer_->append((const char *)bytes, chunk);
+        }
+        break;
+    }
+
+    bytes += chunk;
+    length -= chunk;
+    position_ += chunk;
+
+    if (state_ == DATA && consumed_ == entry.compressedSize) {
+      if (!endEntry()) return false;
+
+      index_++;
+      state_ = SKIP;
+    }
+  }
+
+  position_ += length;
+  return !failed_;
+}
+
+bool ArchiveExtractor::beginEntry() {
+  const ArchiveEntry &entry = entries_[index_];
+  consumed_ = 0;
+
+  if (entry.isDirectory()) return true;
+
+  if (entry.compressedSize > EXTRACT_MEMORY_BUDGET) {
+    writer_.reset(new EntryWriter(entry, paths_[index_], directories_[index_]));
+    return writer_->begin() || fail(writer_->error());
+  }
+
+  // Waits for the pool to make room.
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (buffered_ > 0 &&
+           buffered_ + entry.compressedSize > EXTRACT_MEMORY_BUDGET &&
+           !failed_) {
+      released_.wait(lock);
+    }
+
+    buffered_ += entry.compressedSize;
+  }
+
+  buffer_ = std::make_shared<std::string>();
+  buffer_->reserve((size_t)entry.compressedSize);
+
+  return !failed_;
+}
+
+bool ArchiveExtractor::endEntry() {
+  std::unique_ptr<EntryWriter> writer(std::move(writer_));
+  std::shared_ptr<std::string> buffer(std::move(buffer_));
+
+  if (writer) {
+    return (writer->end() || fail(writer->error())) &&
+           completeEntry(index_, writer.get());
+  }
+
+  if (!buffer) return completeEntry(index_, nullptr);
+
+  dispatch(index_, (const unsigned char *)buffer->data(), buffer->size(),
+           buffer);
+  return true;
+}
+
+// Extracts entry `index` from its compressed `data` on the pool. A `buffer`
+// holding the data is released from the budget once done.
+void ArchiveExtractor::dispatch(size_t index, const unsigned char *data,
+                                uint64_t length,
+                                std::shared_ptr<std::string> buffer) {
+  if (!pool_) pool_.reset(new ThreadPool());
+
+  pool_->submit([this, index, data, length, buffer]() {
+    extractEntry(index, data, length);
+    if (buffer) release(entries_[index].compressedSize);
+  });
+}
+
+// Takes `size` bytes from the budget if they fit, without waiting since the
+// pool is what frees them.
+bool ArchiveExtractor::reserve(uint64_t size) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (buffered_ + size > EXTRACT_MEMORY_BUDGET) return false;
+
+  buffered_ += size;
+  return true;
+}
+
+void ArchiveExtractor::release(uint64_t size) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  buffered_ -= size;
+  released_.notify_all();
+}
+
+void ArchiveExtractor::extractEntry(size_t index, const unsigned char *data,
+                                    uint64_t length) {
+  // Left alone once anything failed.
+  if (failed_) return;
+
+  const ArchiveEntry &entry = entries_[index];
+  EntryWriter writer(entry, paths_[index], directories_[index]);
+  if (!writer.begin()) {
+    fail(writer.error());
+    return;
+  }
+
+  // Inflated at once only while the budget has room for the whole entry.
+  bool whole = writer.inflatesWhole() && reserve(entry.size);
+  bool written = whole ? writer.writeWhole(data, (size_t)length)
+                       : writer.write(data, (size_t)length, true);
+  if (whole) release(entry.size);
+
+  if (!written || !writer.end()) {
+    fail(writer.error());
+    return;
+  }
+
+  completeEntry(index, &writer);
+}
+
+// Records entry `index` as extracted by `writer`, null for directories.
+bool ArchiveExtractor::completeEntry(size_t index, EntryWriter *writer) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const ArchiveEntry &entry = entries_[index];
+
+  if (writer && writer->isSymlink()) {
+    symlinks_.push_back(std::make_pair(paths_[index], writer->target()));
+  }
+
+  completed_++;
+  extracted_ += entry.size;
+  if (progress_) progress_(entry, extracted_, total_);
+
+  return true;
+}
+
+bool ArchiveExtractor::extract(const unsigned char *archive, uint64_t size) {
+  if (failed_ || !prepare()) return false;
+
+  // Largest first, so the entry taking longest does not start last.
+  std::vector<size_t> order(entries_.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return entries_[a].compressedSize > entries_[b].compressedSize;
+  });
+
+  for (size_t index : order) {
+    const ArchiveEntry &entry = entries_[index];
+
+    if (entry.localHeaderOffset > size ||
+        size - entry.localHeaderOffset < LOCAL_HEADER_SIZE ||
+        read32(archive + entry.localHeaderOffset) != LOCAL_HEADER_SIGNATURE) {
+      return fail("Invalid local header for " + entry.name);
+    }
+
+    const unsigned char *header = archive + entry.localHeaderOffset;
+    uint64_t start = entry.localHeaderOffset + LOCAL_HEADER_SIZE +
+                     read16(header + 26) + read16(header + 28);
+    if (start > size || size - start < entry.compressedSize) {
+      return fail("Truncated archive entry " + entry.name);
+    }
+
+    if (entry.isDirectory()) {
+      completeEntry(index, nullptr);
+    } else {
+      dispatch(index, archive + start, entry.compressedSize, nullptr);
+    }
+  }
+
+  index_ = entries_.size();
+  return !failed_;
+}
+
+bool ArchiveExtractor::finish() {
+  if (pool_) pool_->wait();
+  if (failed_) return false;
+
+  if (index_ < entries_.size()) {
+    return fail("Truncated archive entry " + entries_[index_].name);
+  }
+
+  for (const std::pair<fs::path, std::string> &symlink : symlinks_) {
+    std::error_code ec;
+    fs::create_symlink(symlink.second, symlink.first, ec);
+    if (ec) return fail("Could not create " + symlink.first.string());
+  }
+
+  return true;
+}
@@ -0,0 +1,130 @@
+#ifndef ELECTRON_GLOBAL_EXTRACT_HPP
+#define ELECTRON_GLOBAL_EXTRACT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "archive.hpp"
+#include "download.hpp"
+#include "lib/filesystem.hpp"
+#include "thread_pool.hpp"
+
+// Compressed bytes of the entries waiting for or being extracted by the
+// thread pool, and inflated bytes of those inflated at once into memory.
+// Entries larger than that are extracted as they arrive, and entries that
+// would not fit in what is left are streamed instead of inflated at once.
+#define EXTRACT_MEMORY_BUDGET (64 << 20)
+
+// Files of at least this many bytes are allocated at their full size before
+// they are written. Smaller ones take a single write or two anyway.
+#define EXTRACT_PREALLOCATE_MIN (1 << 20)
+
+// Directories kept open to create the files in them, outside Windows.
+#define EXTRACT_OPEN_DIRECTORIES 64
+
+// Called once per extracted entry with the uncompressed bytes of all entries
+// extracted so far, from whichever thread extracted it but never from two at
+// once.
+typedef void (*ExtractProgress)(const ArchiveEntry &entry, uint64_t extracted,
+                                uint64_t total);
+
+class EntryWriter;
+
+// Extracts an archive given the entries of its central directory, either
+// from its bytes in order as they are downloaded or from the whole archive
+// in memory. Entries are inflated and written in parallel on a thread pool
+// with a thread per core.
+//
+// While downloading, the compressed data of each entry is collected and
+// handed to the pool once complete, so an entry is on disk shortly after
+// its last byte arrived. Entries that do not fit EXTRACT_MEMORY_BUDGET are
+// extracted on the downloading thread as they arrive instead.
+class ArchiveExtractor : public DownloadObserver {
+ public:
+  // Extracts `entries`, as returned by parseCentralDirectory(), below
+  // `root`.
+  ArchiveExtractor(const ghc::filesystem::path &root,
+                   const std::vector<ArchiveEntry> &entries,
+                   ExtractProgress progress = nullptr);
+  ~ArchiveExtractor();
+
+  bool received(const char *data, size_t length) override;
+
+  // Extracts every entry from `archive`, the whole archive of `size` bytes,
+  // which must stay valid until finish().
+  bool extract(const unsigned char *archive, uint64_t size);
+
+  // Waits for the entries being extracted, checks that every entry was and
+  // creates the symbolic links, which are left for last so that no entry is
+  // written through one.
+  bool finish();
+
+  // Stops extracting, waiting for the entries being extracted.
+  void cancel();
+
+  // Why the extraction failed, empty if it did not.
+  std::string error();
+
+ private:
+  ArchiveExtractor(const ArchiveExtractor &);
+  ArchiveExtractor &operator=(const ArchiveExtractor &);
+
+  enum State { SKIP, HEADER, NAME, DATA };
+
+  bool fail(const std::string &message);
+  bool prepare();
+  bool beginEntry();
+  bool endEntry();
+  void dispatch(size_t index, const unsigned char *data, uint64_t length,
+                std::shared_ptr<std::string> buffer);
+  void extractEntry(size_t index, const unsigned char *data, uint64_t length);
+  bool reserve(uint64_t size);
+  void release(uint64_t size);
+  bool completeEntry(size_t index, EntryWriter *writer);
+
+  ghc::filesystem::path root_;
+  std::vector<ArchiveEntry> entries_;
+  // Where each entry goes and the descriptor of its directory, or -1, set
+  // by prepare().
+  std::vector<ghc::filesystem::path> paths_;
+  std::vector<int> directories_;
+  // Directories open, closed with the extractor.
+  std::vector<int> descriptors_;
+  bool prepared_ = false;
+  ExtractProgress progress_;
+  uint64_t total_ = 0;
+
+  // Position in the archive and in the current entry.
+  size_t index_ = 0;
+  State state_ = SKIP;
+  uint64_t position_ = 0;
+  std::string header_;
+  uint64_t skip_ = 0;
+  uint64_t consumed_ = 0;
+  // Compressed data of the current entry, unless it is extracted as it
+  // arrives by `writer_`.
+  std::shared_ptr<std::string> buffer_;
+  std::unique_ptr<EntryWriter> writer_;
+
+  std::unique_ptr<ThreadPool> pool_;
+  std::atomic<bool> failed_;
+
+  // Guards what follows, shared with the pool.
+  std::mutex mutex_;
+  std::condition_variable released_;
+  std::string error_;
+  uint64_t buffered_ = 0;
+  uint64_t extracted_ = 0;
+  size_t completed_ = 0;
+  // Links to create in finish(), as path and target.
+  std::vector<std::pair<ghc::filesystem::path, std::string>> symlinks_;
+};
+
+#endif  // ELECTRON_GLOBAL_EXTRACT_HPP
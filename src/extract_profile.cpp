@@ -0,0 +1,150 @@
+#include "extract_profile.hpp"
+
+#include <ctype.h>
+#include <algorithm>
+#include <fstream>
+
+#include "install_index.hpp"
+
+#define LOCALES_DIRECTORY "locales"
+
+static std::vector<std::string> splitPath(const std::string &path) {
+  std::vector<std::string> components;
+
+  size_t start = 0;
+  while (start < path.size()) {
+    size_t end = path.find('/', start);
+    if (end == std::string::npos) end = path.size();
+
+    if (end > start) components.push_back(path.substr(start, end - start));
+    start = end + 1;
+  }
+
+  return components;
+}
+
+static bool endsWith(const std::string &text, const std::string &suffix) {
+  return text.size() >= suffix.size() &&
+         text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Lowercase with `_` for `-`, as macOS names locales like pt_BR.
+static std::string normalizeLocale(const std::string &locale) {
+  std::string normalized;
+  for (char c : locale) {
+    normalized += c == '_' ? '-' : (char)tolower((unsigned char)c);
+  }
+
+  return normalized;
+}
+
+// Name of the locale the entry `name` belongs to, empty if it is none.
+static std::string localeOf(const std::string &name) {
+  std::vector<std::string> components = splitPath(name);
+
+  for (size_t i = 0; i < components.size(); i++) {
+    const std::string &component = components[i];
+
+    if (endsWith(component, ".lproj")) {
+      return component.substr(0, component.size() - 6);
+    }
+
+    if (component == LOCALES_DIRECTORY && i + 2 == components.size()) {
+      const std::string &file = components[i + 1];
+      if (endsWith(file, ".pak")) return file.substr(0, file.size() - 4);
+      if (endsWith(file, ".pak.info")) {
+        return file.substr(0, file.size() - 9);
+      }
+    }
+  }
+
+  return "";
+}
+
+// Whether `locale` is wanted, either by its name or as the language of a
+// wanted locale, which macOS ships as `en.lproj` next to `en_GB.lproj`.
+static bool keepsLocale(const ExtractProfile &profile,
+                        const std::string &locale) {
+  if (profile.locales.empty() || locale == "Base") return true;
+
+  std::string normalized = normalizeLocale(locale);
+
+  std::vector<std::string> wanted = profile.locales;
+  wanted.push_back(EXTRACT_FALLBACK_LOCALE);
+
+  for (const std::string &candidate : wanted) {
+    std::string name = normalizeLocale(candidate);
+    if (normalized == name || normalized == name.substr(0, name.find('-'))) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool excludes(const ExtractProfile &profile, const std::string &name) {
+  std::vector<std::string> components = splitPath(name);
+
+  for (const std::string &pattern : profile.exclude) {
+    std::vector<std::string> leading = splitPath(pattern);
+    if (leading.empty()) continue;
+
+    if (leading.size() == 1 &&
+        std::find(components.begin(), components.end(), leading[0]) !=
+            components.end()) {
+      return true;
+    }
+
+    if (leading.size() <= components.size() &&
+        std::equal(leading.begin(), leading.end(), components.begin())) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void applyExtractProfile(const ExtractProfile &profile,
+                         std::vector<ArchiveEntry> *entries) {
+  if (profile.empty()) return;
+
+  std::vector<ArchiveEntry> kept;
+  kept.reserve(entries->size());
+
+  for (const ArchiveEntry &entry : *entries) {
+    bool skipped = excludes(profile, entry.name);
+
+    std::string locale = localeOf(entry.name);
+    if (!locale.empty() && !keepsLocale(profile, locale)) skipped = true;
+
+    if (!skipped || entry.name == INSTALL_VERSION_FILE) kept.push_back(entry);
+  }
+
+  entries->swap(kept);
+}
+
+static std::string joinList(const std::vector<std::string> &items) {
+  std::string joined;
+  for (const std::string &item : items) {
+    if (!joined.empty()) joined += ", ";
+    joined += item;
+  }
+
+  return joined;
+}
+
+bool writeExtractProfile(const ghc::filesystem::path &path,
+                         const ExtractProfile &profile) {
+  if (profile.empty()) return true;
+
+  std::ofstream file((path / EXTRACT_PROFILE_FILE).string().c_str(),
+                     std::ios::binary | std::ios::trunc);
+  if (!profile.locales.empty()) {
+    file << "locales = " << joinList(profile.locales) << "\n";
+  }
+  if (!profile.exclude.empty()) {
+    file << "exclude = " << joinList(profile.exclude) << "\n";
+  }
+
+  return (bool)file.flush();
+}
@@ -0,0 +1,42 @@
+#ifndef ELECTRON_GLOBAL_EXTRACT_PROFILE_HPP
+#define ELECTRON_GLOBAL_EXTRACT_PROFILE_HPP
+
+#include <string>
+#include <vector>
+
+#include "archive.hpp"
+#include "lib/filesystem.hpp"
+
+// Locale that is always kept, Chromium falls back to it.
+#define EXTRACT_FALLBACK_LOCALE "en-US"
+
+// File in a stripped install recording what was left out of it.
+#define EXTRACT_PROFILE_FILE "extract_profile"
+
+// Parts of the runtime left out of installs, set by the `extract_locales`
+// and `extract_exclude` settings of the user since installs are shared by
+// every app. Skipped entries are neither inflated nor written.
+struct ExtractProfile {
+  // Locales to keep besides EXTRACT_FALLBACK_LOCALE, like "de" or "pt-BR".
+  // Every locale is kept if empty. Locales are `locales/<name>.pak` files,
+  // and `<name>.lproj` directories on macOS.
+  std::vector<std::string> locales;
+  // Names to skip, matched against every component of the path of an entry,
+  // like "swiftshader", or against its leading components, like
+  // "resources/default_app.asar".
+  std::vector<std::string> exclude;
+
+  bool empty() const { return locales.empty() && exclude.empty(); }
+};
+
+// Removes the entries `profile` skips from `entries`. The version file that
+// installs are recognized by is always kept.
+void applyExtractProfile(const ExtractProfile &profile,
+                         std::vector<ArchiveEntry> *entries);
+
+// Records `profile` in EXTRACT_PROFILE_FILE of the install in `path`, in the
+// format of the configuration file. Nothing is written for an empty profile.
+bool writeExtractProfile(const ghc::filesystem::path &path,
+                         const ExtractProfile &profile);
+
+#endif  // ELECTRON_GLOBAL_EXTRACT_PROFILE_HPP
@@ -0,0 +1,184 @@
+#include "inflate.hpp"
+
+#include <limits.h>
+#include <string>
+
+#include "config.hpp"
+
+// The implementation is linked from zip.o.
+#define MINIZ_HEADER_FILE_ONLY
+#include "lib/zip/src/miniz.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+// Inflates through a dictionary that wraps around, so memory stays bounded
+// by the window size whatever the size of the stream.
+class MinizInflater : public Inflater {
+ public:
+  MinizInflater() : inflator_(), dictionary_(TINFL_LZ_DICT_SIZE) {
+    tinfl_init(&inflator_);
+  }
+
+  bool inflate(const unsigned char *data, size_t length, bool last,
+               const InflateOutput &output) override {
+    mz_uint32 flags = last ? 0 : TINFL_FLAG_HAS_MORE_INPUT;
+
+    while (!done_) {
+      size_t in = length;
+      size_t out = TINFL_LZ_DICT_SIZE - offset_;
+
+      tinfl_status status = tinfl_decompress(
+          &inflator_, data, &in, dictionary_.data(),
+          dictionary_.data() + offset_, &out, flags);
+
+      data += in;
+      length -= in;
+
+      if (out > 0 && !output(dictionary_.data() + offset_, out)) return false;
+      offset_ = (offset_ + out) & (TINFL_LZ_DICT_SIZE - 1);
+
+      if (status < TINFL_STATUS_DONE) return false;
+
+      if (status == TINFL_STATUS_DONE) done_ = true;
+      if (status == TINFL_STATUS_NEEDS_MORE_INPUT && length == 0) break;
+    }
+
+    return true;
+  }
+
+  bool done() const override { return done_; }
+
+ private:
+  tinfl_decompressor inflator_;
+  std::vector<unsigned char> dictionary_;
+  size_t offset_ = 0;
+  bool done_ = false;
+};
+
+static Inflater *streamMiniz() { return new MinizInflater(); }
+
+// Inflating at once runs the same tinfl, so it would only cost memory.
+static const InflateBackend minizBackend = {"miniz", streamMiniz, nullptr};
+
+#ifdef HAVE_ZLIB
+#define ZLIB_OUTPUT_SIZE (64 << 10)
+
+class ZlibInflater : public Inflater {
+ public:
+  ZlibInflater() : buffer_(ZLIB_OUTPUT_SIZE) {
+    stream_ = z_stream();
+    initialized_ = inflateInit2(&stream_, -MAX_WBITS) == Z_OK;
+  }
+
+  ~ZlibInflater() {
+    if (initialized_) inflateEnd(&stream_);
+  }
+
+  bool inflate(const unsigned char *data, size_t length, bool last,
+               const InflateOutput &output) override {
+    if (!initialized_) return false;
+
+    while (!done_) {
+      // Fed in pieces zlib can count.
+      uInt in = length > UINT_MAX ? UINT_MAX : (uInt)length;
+      stream_.next_in = (Bytef *)data;
+      stream_.avail_in = in;
+      stream_.next_out = buffer_.data();
+      stream_.avail_out = ZLIB_OUTPUT_SIZE;
+
+      int status = ::inflate(&stream_, Z_NO_FLUSH);
+
+      data += in - stream_.avail_in;
+      length -= in - stream_.avail_in;
+
+      size_t out = ZLIB_OUTPUT_SIZE - stream_.avail_out;
+      if (out > 0 && !output(buffer_.data(), out)) return false;
+
+      if (status == Z_STREAM_END) {
+        done_ = true;
+      } else if (status == Z_BUF_ERROR && out == 0) {
+        // Out of input, which is only fine if more follows.
+        if (length > 0 || last) return false;
+        break;
+      } else if (status != Z_OK) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool done() const override { return done_; }
+
+ private:
+  z_stream stream_;
+  bool initialized_;
+  std::vector<unsigned char> buffer_;
+  bool done_ = false;
+};
+
+static Inflater *streamZlib() { return new ZlibInflater(); }
+
+// Inflating at once measures no faster than streaming with inflate_bench.
+static const InflateBackend zlibBackend = {"zlib", streamZlib, nullptr};
+#endif
+
+#ifdef HAVE_LIBDEFLATE
+static bool inflateLibdeflate(const unsigned char *data, size_t length,
+                              unsigned char *output, size_t size) {
+  libdeflate_decompressor *decompressor = libdeflate_alloc_decompressor();
+  if (!decompressor) return false;
+
+  // Without a place for the actual size, anything short of `size` fails.
+  libdeflate_result result = libdeflate_deflate_decompress(
+      decompressor, data, length, output, size, nullptr);
+  libdeflate_free_decompressor(decompressor);
+
+  return result == LIBDEFLATE_SUCCESS;
+}
+
+// libdeflate cannot stream, entries too large for memory go through zlib
+// or miniz.
+static const InflateBackend libdeflateBackend = {
+    "libdeflate",
+#ifdef HAVE_ZLIB
+    streamZlib,
+#else
+    streamMiniz,
+#endif
+    inflateLibdeflate};
+#endif
+
+const std::vector<const InflateBackend *> &inflateBackends() {
+  static const std::vector<const InflateBackend *> backends = {
+#ifdef HAVE_LIBDEFLATE
+      &libdeflateBackend,
+#endif
+#ifdef HAVE_ZLIB
+      &zlibBackend,
+#endif
+      &minizBackend,
+  };
+
+  return backends;
+}
+
+const InflateBackend &inflateBackend() {
+  static const InflateBackend *selected = []() {
+    std::string name = getConfig("inflate");
+
+    for (const InflateBackend *backend : inflateBackends()) {
+      if (name == backend->name) return backend;
+    }
+
+    return inflateBackends().front();
+  }();
+
+  return *selected;
+}
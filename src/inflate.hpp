@@ -0,0 +1,54 @@
+#ifndef ELECTRON_GLOBAL_INFLATE_HPP
+#define ELECTRON_GLOBAL_INFLATE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+// Entries up to this many bytes once inflated may be inflated at once into
+// memory by backends that can, larger ones are streamed.
+#define INFLATE_WHOLE_LIMIT (256 << 20)
+
+// Receives inflated bytes in order, returns false to stop inflating.
+typedef std::function<bool(const unsigned char *data, size_t length)>
+    InflateOutput;
+
+// Inflates a raw deflate stream given in pieces.
+class Inflater {
+ public:
+  virtual ~Inflater() {}
+
+  // Inflates the next `length` bytes of the stream, `last` if they end it,
+  // passing what comes out to `output`. Returns false if the stream is
+  // corrupt or `output` failed.
+  virtual bool inflate(const unsigned char *data, size_t length, bool last,
+                       const InflateOutput &output) = 0;
+
+  // Whether the end of the stream was reached.
+  virtual bool done() const = 0;
+};
+
+// A deflate implementation. miniz is always built in, zlib (or zlib-ng in
+// its compatible mode) with HAVE_ZLIB and libdeflate with HAVE_LIBDEFLATE.
+struct InflateBackend {
+  const char *name;
+
+  // Starts inflating a stream given in pieces.
+  Inflater *(*stream)();
+
+  // Inflates the whole stream in `data` into `output`, which is exactly as
+  // large as the stream inflates to. Returns false if it is corrupt or of
+  // another size. Null unless that is faster than streaming, which only
+  // holds for libdeflate.
+  bool (*whole)(const unsigned char *data, size_t length,
+                unsigned char *output, size_t size);
+};
+
+// The backends built in, fastest first.
+const std::vector<const InflateBackend *> &inflateBackends();
+
+// The backend named by the `inflate` setting, or the fastest one.
+const InflateBackend &inflateBackend();
+
+#endif  // ELECTRON_GLOBAL_INFLATE_HPP
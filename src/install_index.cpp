@@ -0,0 +1,74 @@
+#include "install_index.hpp"
+
+#include <ctype.h>
+#include <fstream>
+#include <vector>
+
+#include "platform.hpp"
+
+namespace fs = ghc::filesystem;
+
+bool readInstall(const fs::path &path, Install *install) {
+  std::error_code ec;
+  if (!fs::exists(path / ELECTRON_EXECUTABLE, ec)) return false;
+
+  std::ifstream file((path / INSTALL_VERSION_FILE).string().c_str());
+
+  std::string name;
+  if (!std::getline(file, name)) return false;
+
+  while (!name.empty() && isspace((unsigned char)name.back())) name.pop_back();
+
+  if (!parseSemVer(name.data(), name.size(), &install->version)) return false;
+
+  install->path = path;
+  install->name = name;
+  return true;
+}
+
+// Whether `a` is preferred over `b`: any stable release over pre-releases,
+// then the newer one.
+static bool preferred(const SemVer &a, const SemVer &b) {
+  if (a.prerelease.empty() != b.prerelease.empty()) {
+    return a.prerelease.empty();
+  }
+
+  return compareSemVer(a, b) > 0;
+}
+
+// Reads every complete install in the directories of `store`.
+static std::vector<Install> listInstalls(const fs::path &store) {
+  std::vector<Install> installs;
+
+  std::error_code ec;
+  for (fs::directory_iterator entry(store, ec), end; !ec && entry != end;
+       entry.increment(ec)) {
+    // Dot directories hold extractions in progress.
+    if (entry->path().filename().string().compare(0, 1, ".") == 0) continue;
+
+    Install install;
+    std::error_code entryError;
+    if (entry->is_directory(entryError) &&
+        readInstall(entry->path(), &install)) {
+      installs.push_back(install);
+    }
+  }
+
+  return installs;
+}
+
+bool findNewestInstall(const fs::path &store, unsigned major,
+                       Install *install) {
+  bool found = false;
+
+  for (const Install &candidate : listInstalls(store)) {
+    if (candidate.version.major != major) continue;
+
+    if (!found || preferred(candidate.version, install->version)) {
+      *install = candidate;
+      found = true;
+    }
+  }
+
+  return found;
+}
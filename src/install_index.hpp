@@ -0,0 +1,29 @@
+#ifndef ELECTRON_GLOBAL_INSTALL_INDEX_HPP
+#define ELECTRON_GLOBAL_INSTALL_INDEX_HPP
+
+#include <string>
+
+#include "lib/filesystem.hpp"
+#include "semver.hpp"
+
+// Runtimes already extracted into the store. Every Electron archive ships a
+// `version` file next to the executable, so installs are recognized by their
+// contents rather than by the name of their directory. Directories whose
+// name starts with a dot are skipped, they are still being extracted.
+#define INSTALL_VERSION_FILE "version"
+
+struct Install {
+  ghc::filesystem::path path;
+  std::string name;
+  SemVer version;
+};
+
+// Reads the release of the install in `path`, if it is complete.
+bool readInstall(const ghc::filesystem::path &path, Install *install);
+
+// Finds the newest runtime of `major` in the directories of `store`,
+// preferring stable releases like the registry resolution does.
+bool findNewestInstall(const ghc::filesystem::path &store, unsigned major,
+                       Install *install);
+
+#endif  // ELECTRON_GLOBAL_INSTALL_INDEX_HPP
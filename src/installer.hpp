@@ -0,0 +1,31 @@
+#ifndef ELECTRON_GLOBAL_INSTALLER_HPP
+#define ELECTRON_GLOBAL_INSTALLER_HPP
+
+// Installer helpers shared between its translation units. Implemented in
+// main.cpp.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include <curl/curl.h>
+
+// Logs the message and shows it in an error dialog, then exits.
+void error(const char *message, ...);
+
+// Reports a failed transfer of `url` through error().
+void transferError(const char *url, CURLcode response);
+
+// Case-insensitively matches the lowercase header `name` against the start of
+// a header line and stores its trimmed value.
+bool readHeader(const char *line, size_t length, const char *name,
+                std::string *value);
+
+// Applies the options every transfer of the installer shares.
+void setTransferDefaults(CURL *curl);
+
+// Records the DNS, connect, TLS and first byte phases of a finished transfer
+// that started at `start`.
+void traceTransfer(CURL *curl, const char *url, uint64_t start);
+
+#endif  // ELECTRON_GLOBAL_INSTALLER_HPP
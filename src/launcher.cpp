@@ -0,0 +1,211 @@
+// Launch stub. This is the `electron` executable shipped with every app, so
+// it runs on every launch and is kept as small as possible: it only reads
+// the version, looks for the runtime in the store and executes it.
+// Everything that needs GTK, libcurl or rapidjson lives in the installer,
+// which is executed only when the runtime is missing.
+//
+// The stub is linked without libstdc++; only the C library is allowed here.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+#include "platform.hpp"
+#include "store.hpp"
+#include "trace.hpp"
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+// Records the exec of `path` and flushes the trace, since a successful exec
+// never returns to write it.
+void traceExec(const char *name, const char *path) {
+  if (!traceEnabled()) return;
+
+  uint64_t now = traceNow();
+  traceEvent(name, now, now, path);
+  traceFlush();
+}
+
+#ifdef _WIN32
+int run(const char *file, char *commandLine) {
+  STARTUPINFO startupInfo;
+  ZeroMemory(&startupInfo, sizeof(startupInfo));
+
+  startupInfo.cb = sizeof(startupInfo);
+
+  PROCESS_INFORMATION processInfo;
+
+  if (!CreateProcess(file, commandLine, NULL, NULL, FALSE,
+                     CREATE_DEFAULT_ERROR_MODE, NULL, NULL, &startupInfo,
+                     &processInfo)) {
+    return -1;
+  }
+
+  WaitForSingleObject(processInfo.hProcess, INFINITE);
+
+  DWORD exitCode = 1;
+  GetExitCodeProcess(processInfo.hProcess, &exitCode);
+
+  CloseHandle(processInfo.hProcess);
+  CloseHandle(processInfo.hThread);
+
+  return (int)exitCode;
+}
+#endif
+
+int launchElectron(const char *path) {
+#ifdef _WIN32
+  if (GetFileAttributesA(path) == INVALID_FILE_ATTRIBUTES) return -1;
+
+  char commandLine[PATH_MAX + sizeof(ASAR_PATH) + 4];
+  snprintf(commandLine, sizeof(commandLine), "\"%s\" " ASAR_PATH, path);
+
+  traceExec("exec electron", path);
+  return run(path, commandLine);
+#else
+  const char *const argv[] = {path, ASAR_PATH, nullptr};
+  traceExec("exec electron", path);
+  execv(path, const_cast<char *const *>(argv));
+
+  // Anything but a missing runtime is a real error and the installer would
+  // not be able to fix it.
+  if (errno != ENOENT && errno != ENOTDIR) {
+    fprintf(stderr, "Error launching %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  return -1;
+#endif
+}
+
+#ifndef _WIN32
+// Builds the environment for the plan: its overrides first, followed by every
+// inherited variable that is not overridden.
+char **mergeEnvironment(const char *const *overrides) {
+  if (!overrides[0]) return environ;
+
+  size_t count = 0;
+  while (environ[count]) count++;
+  for (size_t i = 0; overrides[i]; i++) count++;
+
+  char **env = (char **)malloc((count + 1) * sizeof(char *));
+  if (!env) return environ;
+
+  size_t length = 0;
+  for (size_t i = 0; overrides[i]; i++) {
+    env[length++] = const_cast<char *>(overrides[i]);
+  }
+
+  for (size_t i = 0; environ[i]; i++) {
+    const char *separator = strchr(environ[i], '=');
+    size_t nameLength =
+        separator ? (size_t)(separator - environ[i]) : strlen(environ[i]);
+
+    bool overridden = false;
+    for (size_t j = 0; overrides[j] && !overridden; j++) {
+      overridden = strncmp(overrides[j], environ[i], nameLength) == 0 &&
+                   overrides[j][nameLength] == '=';
+    }
+
+    if (!overridden) env[length++] = environ[i];
+  }
+
+  env[length] = nullptr;
+  return env;
+}
+
+// Executes the launch plan stored next to the install. Returns only if there
+// is no usable plan, in which case the caller falls back to the store path.
+void launchFromPlan(const char *version) {
+  uint64_t start = traceNow();
+
+  char path[PATH_MAX];
+  if (!formatStorePath(path, sizeof(path), version, LAUNCH_PLAN_FILE)) return;
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    traceEvent("store lookup", start, traceNow(), "no launch plan");
+    return;
+  }
+
+  static char data[LAUNCH_PLAN_MAX_SIZE];
+  ssize_t length = read(fd, data, sizeof(data));
+  close(fd);
+
+  LaunchPlan plan;
+  if (length <= 0 || (size_t)length == sizeof(data) ||
+      !parseLaunchPlan(data, (size_t)length, &plan)) {
+    traceEvent("store lookup", start, traceNow(), "no launch plan");
+    return;
+  }
+
+  traceEvent("store lookup", start, traceNow(), path);
+  traceExec("exec electron", plan.executable);
+  execve(plan.executable, const_cast<char *const *>(plan.argv),
+         mergeEnvironment(plan.env));
+
+  // A stale plan, e.g. after the runtime was removed by hand, is not fatal.
+}
+#endif
+
+int launchInstaller() {
+#ifdef _WIN32
+  char commandLine[] = INSTALLER_PATH;
+  traceExec("exec installer", INSTALLER_PATH);
+  int result = run(INSTALLER_PATH, commandLine);
+#else
+  const char *const argv[] = {INSTALLER_PATH, nullptr};
+  traceExec("exec installer", INSTALLER_PATH);
+  execv(INSTALLER_PATH, const_cast<char *const *>(argv));
+  int result = -1;
+#endif
+
+  if (result < 0) {
+    fprintf(stderr, "Error launching " INSTALLER_PATH "\n");
+    return 1;
+  }
+
+  return result;
+}
+
+int main() {
+  traceInit("launcher");
+
+  uint64_t start = traceNow();
+
+  char version[MAX_VERSION_LENGTH];
+  if (!readVersion(version, sizeof(version))) {
+    fprintf(stderr, "Invalid Electron version in " ELECTRON_VERSION_PATH "\n");
+    return 1;
+  }
+
+  traceEvent("read version file", start, traceNow(), version);
+
+#ifndef _WIN32
+  launchFromPlan(version);
+#endif
+
+  char path[PATH_MAX];
+  if (!formatStorePath(path, sizeof(path), version, ELECTRON_EXECUTABLE)) {
+    fprintf(stderr, "Could not determine the Electron store path\n");
+    return 1;
+  }
+
+  int result = launchElectron(path);
+  if (result >= 0) return result;
+
+  return launchInstaller();
+}
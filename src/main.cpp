@@ -1,78 +1,84 @@
+#include <assert.h>
+#include <ctype.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <string.h>
 #include <algorithm>
 #include <chrono>
-#include <fstream>
+#include <future>
 #include <iostream>
-#include <streambuf>
+#include <memory>
 #include <string>
 #include <thread>
 
 #include <curl/curl.h>
 #include "lib/filesystem.hpp"
 #include "lib/libui/ui.h"
-#include "lib/rapidjson/include/rapidjson/document.h"
-#include "lib/zip/src/zip.h"
+#include "archive.hpp"
+#include "config.hpp"
+#include "download.hpp"
+#include "extract.hpp"
+#include "extract_profile.hpp"
+#include "install_index.hpp"
+#include "installer.hpp"
+#include "manifest.hpp"
+#include "mapped_file.hpp"
+#include "part_file.hpp"
+#include "platform.hpp"
+#include "registry.hpp"
+#include "sha256.hpp"
+#include "store.hpp"
+#include "trace.hpp"
+#include "transfer.hpp"
 
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
-#define PROGRAM_NAME "electron-launcher"
-#define PROGRAM_VERSION "0.1"
-
-#define BIN_DIR ".electron-global"
-
-#if defined(WIN32) || defined(_WIN32)
-#define OS "win32"
-#define HOME_ENV "HOMEPATH"
-#define ELECTRON_VERSION_PATH "electron_version"
-#define ASAR_PATH "resources/app.asar"
-#elif defined(__APPLE__)
-#define OS "darwin"
-#define HOME_ENV "HOME"
-#define ELECTRON_VERSION_PATH "../Resources/electron_version"
-#define ASAR_PATH "../Resources/app.asar"
-#elif defined(__linux__)
-#define OS "linux"
-#define HOME_ENV "HOME"
-#define ELECTRON_VERSION_PATH "electron_version"
-#define ASAR_PATH "resources/app.asar"
-#else
-#error OS not detected
-#endif
-
-#if defined(__i386__) || (defined(_WIN32) && !defined(_WIN64))
-#define ARCH "ia32"
-#elif defined(__x86_64__) || defined(_WIN64)
-#define ARCH "x64"
-#elif defined(__ARM_ARCH_7__)
-#define ARCH "armv7l"
-#elif defined(__aarch64__)
-#define ARCH "arm64"
-#else
-#error CPU architecture not detected
-#endif
-
-#define BUILDARCHSTRING OS "-" ARCH
-
 namespace fs = ghc::filesystem;
 
-struct CurlBuffer {
-  char *buffer;
-  size_t length;
-  size_t size;
-};
+// Milliseconds the registry may take to name a newer release before an
+// installed runtime of the same major is launched instead.
+#define RESOLVE_BUDGET 1000
+// Seconds SHASUMS256.txt may take to download alongside the archive, and
+// how often it is requested from each mirror before giving up on it.
+#define CHECKSUMS_TIMEOUT 30
+#define CHECKSUMS_ATTEMPTS 3
+// Milliseconds the registry may take to confirm the release predicted from
+// its cached version list before the prediction is installed as is.
+#define SPECULATION_BUDGET 10000
+// Milliseconds a connection to the release host may take to warm up while
+// the version is resolved.
+#define PRECONNECT_TIMEOUT 3000
+// Megabytes an archive extracted while it downloads may take to download
+// into memory rather than to disk.
+#define MEMORY_BUDGET 256
+
+// Default of the `release_mirrors` setting, under which each release has a
+// directory named after its version.
+#define RELEASES_URL "https://github.com/electron/electron/releases/download/"
 
 uiWindow *window = NULL;
 uiLabel *label = NULL;
 uiProgressBar *progressBar = NULL;
 
 fs::path dest;
+// Install that is launched, `dest` unless an install of the same major in
+// another directory of the store is reused.
+fs::path runtime;
 fs::path zipPath;
+// Directory the runtime is extracted into before it is moved to `dest`.
+fs::path staging;
 fs::path binPath;
 
 std::string electronVersion;
+// Release pinned at build time, if the dist ships a manifest.
+Manifest manifest;
+// Release the registry resolves to while the release predicted from the
+// cached version list downloads, see resolveRuntime().
+std::future<std::string> resolution;
+// Whether the download stopped because `resolution` named another release.
+bool mispredicted = false;
 
 bool done = false;
 
@@ -80,8 +86,10 @@ fs::path getHomePath(std::string subpath) {
   return fs::path(getenv(HOME_ENV)) / subpath;
 }
 
+// The partial download is kept to be resumed, see download.hpp.
 void cancel() {
   fs::remove_all(dest);
+  fs::remove_all(staging);
   fs::remove(zipPath);
 
   exit(0);
@@ -89,6 +97,7 @@ void cancel() {
 
 void clean() {
   fs::remove_all(dest);
+  fs::remove_all(staging);
   fs::remove(zipPath);
 }
 
@@ -121,26 +130,13 @@ int onWindowClose(uiWindow *w, void *data) {
 
 void setStatus(const char *status) { uiLabelSetText(label, status); }
 
-bool extract(fs::path archive, fs::path path) {
-  return zip_extract((const char *)archive.c_str(), (const char *)path.c_str(),
-                     NULL, NULL) == 0;
-}
-
 static size_t onWrite(const char *contents, size_t size, size_t nmemb,
                       void *userp) {
   ((std::string *)userp)->append((char *)contents, size * nmemb);
   return size * nmemb;
 }
 
-static size_t onWriteFile(const char *ptr, size_t size, size_t nmemb,
-                          void *userdata) {
-  FILE *file = (FILE *)userdata;
-
-  return fwrite(ptr, size, nmemb, file);
-}
-
-static int onProgress(void *clientp, double dltotal, double dlnow,
-                      double ultotal, double ulnow) {
+static void onProgress(uint64_t received, uint64_t total) {
   static unsigned long lastUiTime = 0;
 
   auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -151,115 +147,367 @@ static int onProgress(void *clientp, double dltotal, double dlnow,
     lastUiTime = now;
 
     uiProgressBarSetValue(progressBar,
-                          dltotal > 0 ? (int)((dlnow / dltotal) * 100) : 0);
+                          total > 0 ? (int)(received * 100 / total) : 0);
   }
+}
 
-  return 0;
+static void onExtractProgress(const ArchiveEntry &entry, uint64_t extracted,
+                              uint64_t total) {
+  onProgress(extracted, total);
 }
 
-std::string fetch(const char *url) {
-  CURL *curl = curl_easy_init();
-  if (!curl) {
-    error("Error initializing libcurl");
-    return "";
+void transferError(const char *url, CURLcode response) {
+  switch (response) {
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_COULDNT_RESOLVE_HOST:
+      error(
+          "Could not connect (%i)\nPlease ensure you have access "
+          "to the internet",
+          response);
+      break;
+    default:
+      error("Error retrieving %s\n%s", url, curl_easy_strerror(response));
   }
+}
 
-  std::string readBuffer;
+bool readHeader(const char *line, size_t length, const char *name,
+                std::string *value) {
+  size_t nameLength = strlen(name);
+  if (length <= nameLength || line[nameLength] != ':') return false;
 
-  curl_easy_setopt(curl, CURLOPT_URL, url);
+  for (size_t i = 0; i < nameLength; i++) {
+    if (tolower((unsigned char)line[i]) != name[i]) return false;
+  }
+
+  size_t start = nameLength + 1, end = length;
+  while (start < end && isspace((unsigned char)line[start])) start++;
+  while (end > start && isspace((unsigned char)line[end - 1])) end--;
+
+  value->assign(line + start, end - start);
+  return true;
+}
+
+void setTransferDefaults(CURL *curl) {
+  curl_easy_setopt(curl, CURLOPT_SHARE, transferShare());
   curl_easy_setopt(curl, CURLOPT_USERAGENT, PROGRAM_NAME "/" PROGRAM_VERSION);
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, true);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, onWrite);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
+  // An empty string enables every encoding libcurl was built with.
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+}
 
-  CURLcode response = curl_easy_perform(curl);
+void traceTransfer(CURL *curl, const char *url, uint64_t start) {
+  if (!traceEnabled()) return;
+
+  double redirect = 0, nameLookup = 0, connect = 0, appConnect = 0,
+         startTransfer = 0;
+  curl_easy_getinfo(curl, CURLINFO_REDIRECT_TIME, &redirect);
+  curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME, &nameLookup);
+  curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &connect);
+  curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME, &appConnect);
+  curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &startTransfer);
+
+  auto at = [start](double seconds) {
+    return start + (uint64_t)(seconds * 1000000);
+  };
+
+  if (redirect > 0) traceEvent("redirects", start, at(redirect), url);
+  traceEvent("dns", at(redirect), at(nameLookup), url);
+  traceEvent("connect", at(nameLookup), at(connect), url);
+  if (appConnect > 0) traceEvent("tls", at(connect), at(appConnect), url);
+  traceEvent("first byte", at(appConnect > 0 ? appConnect : connect),
+             at(startTransfer), url);
+}
 
-  if (response != CURLE_OK) {
-    if (response != CURLE_ABORTED_BY_CALLBACK) {
-      switch (response) {
-        case CURLE_COULDNT_CONNECT:
-        case CURLE_COULDNT_RESOLVE_HOST:
-          error(
-              "Could not connect (%i)\nPlease ensure you have access "
-              "to the internet",
-              response);
-          break;
-        default:
-          error("Error retrieving %s\n%s", url, curl_easy_strerror(response));
-      }
-    }
+// Checks a predicted release against the resolution once it is known, or
+// waits for it if `wait` is set. On a misprediction, switches
+// `electronVersion` to the resolved release and returns false.
+bool confirmPrediction(bool wait) {
+  if (!resolution.valid()) return true;
+
+  if (!wait && resolution.wait_for(std::chrono::seconds(0)) !=
+                   std::future_status::ready) {
+    return true;
   }
 
-  curl_easy_cleanup(curl);
+  // A failed lookup keeps the prediction, as the cached list is what an
+  // offline resolution would use as well.
+  std::string resolved = resolution.get();
+  if (resolved.empty() || resolved == electronVersion) return true;
+
+  uint64_t now = traceNow();
+  traceEvent("misprediction", now, now, resolved.c_str());
 
-  return readBuffer;
+  electronVersion = resolved;
+  mispredicted = true;
+  return false;
 }
 
-bool download(std::string url, const char *filename) {
-  CURL *curl = curl_easy_init();
-  if (!curl) {
-    clean();
-    error("Error initializing curl");
-    return false;
+// Hashes the archive in order as it downloads and passes it on to the
+// extractor, if any. Stops a predicted download as soon as it turns out to
+// be the wrong release.
+class ChecksumObserver : public DownloadObserver {
+ public:
+  explicit ChecksumObserver(DownloadObserver *next) : next_(next) {}
+
+  bool received(const char *data, size_t length) override {
+    if (!confirmPrediction(false)) return false;
+
+    sha256_.update(data, length);
+    size_ += length;
+    return !next_ || next_->received(data, length);
   }
 
-  FILE *file = fopen(filename, "wb");
-  if (!file) {
+  std::string finish() { return sha256_.finish(); }
+
+  uint64_t size() const { return size_; }
+
+ private:
+  Sha256 sha256_;
+  uint64_t size_ = 0;
+  DownloadObserver *next_;
+};
+
+// Downloads the first of the mirrored `urls` to answer to `filename`, or
+// only into memory if `inMemory` is set, see downloadFile(). Sets `digest`
+// to its SHA-256 and `size` to its size.
+bool download(const std::vector<std::string> &urls, const char *filename,
+              ArchiveExtractor *extractor, bool inMemory, std::string *digest,
+              uint64_t *size) {
+  ChecksumObserver checksum(extractor);
+  const std::string &url = urls.front();
+
+  uint64_t start = traceNow();
+  CURLcode response =
+      downloadFile(urls, filename, onProgress, &checksum, inMemory);
+  traceEvent("download", start, traceNow(), url.c_str());
+
+  if (response != CURLE_OK) {
+    if (mispredicted) return false;
+
+    if (extractor) extractor->cancel();
     clean();
-    error("Failed to write to %s", filename);
+
+    if (extractor && !extractor->error().empty()) {
+      // Resuming would only extract the same bytes again.
+      std::error_code ec;
+      fs::remove(std::string(filename) + PART_SUFFIX, ec);
+      fs::remove(std::string(filename) + PART_STATE_SUFFIX, ec);
+
+      error("An error occurred extracting the downloaded Electron "
+            "archive\n%s",
+            extractor->error().c_str());
+    } else {
+      transferError(url.c_str(), response);
+    }
+
     return false;
   }
 
+  *digest = checksum.finish();
+  *size = checksum.size();
+  return true;
+}
+
+// What the SHASUMS256.txt of a release says about one of its files.
+struct Checksum {
+  enum Status {
+    // `hash` holds its lowercase hex SHA-256.
+    FOUND,
+    // The release has no SHASUMS256.txt, or it does not list the file.
+    UNPUBLISHED,
+    // The list could not be read, for `reason`.
+    UNAVAILABLE,
+  };
+
+  Status status = UNAVAILABLE;
+  std::string hash;
+  std::string reason;
+};
+
+// Looks up the SHA-256 of the file `name` in the SHASUMS256.txt at `url`.
+// Only a 404 or a list without the file count as not published, any other
+// failure leaves the checksum unavailable.
+Checksum fetchChecksum(const std::string &url, const std::string &name) {
+  Checksum checksum;
+
+  CURL *curl = curl_easy_init();
+  if (!curl) {
+    checksum.reason = "Error initializing libcurl";
+    return checksum;
+  }
+
+  std::string sums;
+
+  setTransferDefaults(curl);
+  // Runs alongside the download, see transferShare().
+  curl_easy_setopt(curl, CURLOPT_SHARE, nullptr);
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-  curl_easy_setopt(curl, CURLOPT_USERAGENT, PROGRAM_NAME "/" PROGRAM_VERSION);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, true);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, onWriteFile);
-  curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, onProgress);
-  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, false);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, file);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, CHECKSUMS_TIMEOUT);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, onWrite);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sums);
 
+  uint64_t start = traceNow();
   CURLcode response = curl_easy_perform(curl);
+  traceTransfer(curl, url.c_str(), start);
 
-  bool success = true;
+  long status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+  curl_easy_cleanup(curl);
 
-  if (response != CURLE_OK) {
-    if (response != CURLE_ABORTED_BY_CALLBACK) {
-      clean();
-      error("Error downloading %s: %s", filename, curl_easy_strerror(response));
-    }
+  // A file:// mirror without the list does not publish it either.
+  if (response == CURLE_FILE_COULDNT_READ_FILE) {
+    checksum.status = Checksum::UNPUBLISHED;
+    return checksum;
+  } else if (response != CURLE_OK) {
+    checksum.reason = url + "\n" + curl_easy_strerror(response);
+    return checksum;
+  }
 
-    success = false;
+  if (status == 404) {
+    checksum.status = Checksum::UNPUBLISHED;
+    return checksum;
+  } else if (status >= 300) {
+    checksum.reason = url + "\nHTTP " + std::to_string(status);
+    return checksum;
   }
 
-  curl_easy_cleanup(curl);
+  // Lines are `<hash> *<name>`.
+  for (size_t lineStart = 0; lineStart < sums.size();) {
+    size_t lineEnd = sums.find('\n', lineStart);
+    if (lineEnd == std::string::npos) lineEnd = sums.size();
+
+    std::string line = sums.substr(lineStart, lineEnd - lineStart);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
 
-  fclose(file);
+    lineStart = lineEnd + 1;
 
-  return success;
+    if (line.size() != 66 + name.size() || line[64] != ' ' ||
+        (line[65] != '*' && line[65] != ' ') ||
+        line.compare(66, std::string::npos, name) != 0) {
+      continue;
+    }
+
+    std::string hash = line.substr(0, 64);
+    for (char &c : hash) {
+      if (!isxdigit((unsigned char)c)) {
+        checksum.reason = url + "\nMalformed checksum for " + name;
+        return checksum;
+      }
+      c = (char)tolower((unsigned char)c);
+    }
+
+    checksum.status = Checksum::FOUND;
+    checksum.hash = hash;
+    return checksum;
+  }
+
+  checksum.status = Checksum::UNPUBLISHED;
+  return checksum;
 }
 
-std::string getMatchingVersion(std::string major) {
-  auto data = fetch("http://registry.npmjs.org/electron");
+// Looks up the SHA-256 of `name` on each of the mirrored `urls` in turn,
+// retrying those that cannot be read. It is only unpublished if every mirror
+// answered that it does not list it.
+Checksum fetchMirroredChecksum(std::vector<std::string> urls,
+                               std::string name) {
+  Checksum result;
+  result.status = Checksum::UNPUBLISHED;
+
+  for (const std::string &url : urls) {
+    Checksum checksum;
+    for (int attempt = 0; attempt < CHECKSUMS_ATTEMPTS &&
+                          checksum.status == Checksum::UNAVAILABLE;
+         attempt++) {
+      checksum = fetchChecksum(url, name);
+    }
 
-  rapidjson::Document document;
-  document.Parse(data.c_str());
+    if (checksum.status == Checksum::FOUND) return checksum;
 
-  auto versionsObj = document["versions"].GetObject();
+    if (checksum.status == Checksum::UNAVAILABLE &&
+        result.status != Checksum::UNAVAILABLE) {
+      result = checksum;
+    }
+  }
 
-  std::vector<std::string> versions;
+  return result;
+}
 
-  for (rapidjson::Value::ConstMemberIterator itr = versionsObj.MemberBegin();
-       itr != versionsObj.MemberEnd(); ++itr) {
-    versions.push_back(std::string(itr->name.GetString()));
+// Reads the central directory of the archive at `url` with range requests:
+// the end of the archive first, then the directory itself unless it was
+// part of that. Returns false if the server does not support ranges.
+bool fetchCentralDirectory(const std::string &url,
+                           std::vector<ArchiveEntry> *entries,
+                           uint64_t *size) {
+  uint64_t start = traceNow();
+
+  char range[48];
+  snprintf(range, sizeof(range), "-%d", ARCHIVE_TAIL_SIZE);
+
+  std::string tail;
+  CURLcode response = fetchRange(url, range, &tail, size);
+
+  CentralDirectory directory;
+  bool found = response == CURLE_OK &&
+               findCentralDirectory((const unsigned char *)tail.data(),
+                                    tail.size(), *size, &directory);
+
+  std::string data;
+  uint64_t tailStart = *size - tail.size();
+
+  if (found && directory.offset >= tailStart) {
+    data = tail.substr(directory.offset - tailStart, directory.size);
+  } else if (found && directory.size > 0) {
+    snprintf(range, sizeof(range), "%" PRIu64 "-%" PRIu64, directory.offset,
+             directory.offset + directory.size - 1);
+
+    uint64_t rangeSize = 0;
+    response = fetchRange(url, range, &data, &rangeSize);
+    found = response == CURLE_OK && rangeSize == *size;
   }
 
-  for (int i = versions.size() - 1; i >= 0; i--) {
-    if (versions[i][0] == major[0]) {
-      return versions[i];
-    }
+  found = found && parseCentralDirectory((const unsigned char *)data.data(),
+                                         data.size(), directory, entries);
+
+  traceEvent("central directory", start, traceNow(), url.c_str());
+
+  return found;
+}
+
+// What of the runtime to extract, from the user's settings, which apply to
+// every app sharing the store.
+static ExtractProfile extractProfile() {
+  ExtractProfile profile;
+  profile.locales = getConfigList("extract_locales", "");
+  profile.exclude = getConfigList("extract_exclude", "");
+
+  return profile;
+}
+
+// Extracts the archive at `zipPath` in place, for servers without ranges.
+bool extractDownloaded(std::unique_ptr<ArchiveExtractor> *extractor) {
+  MappedFile archive;
+  if (!archive.open(zipPath.string().c_str(), true)) return false;
+
+  size_t tailSize = archive.size() < ARCHIVE_TAIL_SIZE ? archive.size()
+                                                        : ARCHIVE_TAIL_SIZE;
+  const unsigned char *tail = archive.data() + archive.size() - tailSize;
+
+  CentralDirectory directory;
+  std::vector<ArchiveEntry> entries;
+  if (!findCentralDirectory(tail, tailSize, archive.size(), &directory) ||
+      !parseCentralDirectory(archive.data() + directory.offset,
+                             (size_t)directory.size, directory, &entries)) {
+    return false;
   }
 
-  return "";
+  applyExtractProfile(extractProfile(), &entries);
+
+  extractor->reset(
+      new ArchiveExtractor(staging, entries, onExtractProgress));
+
+  // The archive stays mapped until every entry is extracted.
+  bool extracted = (*extractor)->extract(archive.data(), archive.size());
+  return (*extractor)->finish() && extracted;
 }
 
 template <std::size_t N>
@@ -294,58 +542,302 @@ int execvp_win32(char *file, char argv[], int *launchError) {
 #endif
 
 int launchElectron() {
+  fs::path executable = runtime / ELECTRON_EXECUTABLE;
+
+  // A successful exec never returns to flush the trace.
+  uint64_t now = traceNow();
+  traceEvent("exec electron", now, now, executable.string().c_str());
+  traceFlush();
+
 #if defined(WIN32) || defined(_WIN32)
-  std::string arg = (dest / "electron.exe").string() + " " ASAR_PATH;
+  std::string arg = "\"" + executable.string() + "\" " ASAR_PATH;
   char *argv = strdup(arg.c_str());
 
-  int launchError;
+  int launchError = 0;
   int result =
-      execvp_win32(strdup((dest / "electron.exe").c_str()), argv, &launchError);
+      execvp_win32(strdup(executable.string().c_str()), argv, &launchError);
 
   if (launchError) {
-    error("Error %i launching %s", launchError,
-          strdup((dest / "electron.exe").c_str()));
+    error("Error %i launching %s", launchError, executable.string().c_str());
     result = 1;
   }
 
   return result;
-#elif defined(__APPLE__)
-  const char *const argv[] = {(dest / "Electron.app").c_str(), ASAR_PATH,
-                              nullptr};
-  return execvp2((dest / "Electron.app").c_str(), argv);
-#elif defined(__linux__)
-  const char *const argv[] = {(dest / "electron").c_str(), ASAR_PATH, nullptr};
-  return execvp2((dest / "electron").c_str(), argv);
 #else
-#error OS not detected
+  const char *const argv[] = {executable.c_str(), ASAR_PATH, nullptr};
+  return execvp2(executable.c_str(), argv);
 #endif
 }
 
-void downloadThread(void) {
-  std::string url = "https://github.com/electron/electron/releases/download/v" +
-                    electronVersion + "/electron-v" + electronVersion +
-                    "-" OS "-" ARCH ".zip";
+// Writes the launch plan read by the stub on warm launches, see store.hpp.
+// Failing to write it only costs the stub a few extra syscalls.
+void writeLaunchPlan() {
+#ifndef _WIN32
+  std::string executable =
+      fs::absolute(runtime / ELECTRON_EXECUTABLE).string();
+
+  std::string plan(LAUNCH_PLAN_MAGIC, sizeof(LAUNCH_PLAN_MAGIC));
+  plan.append(executable.c_str(), executable.size() + 1);
+  plan.append(executable.c_str(), executable.size() + 1);
+  plan.append(ASAR_PATH, sizeof(ASAR_PATH));
+  plan.push_back('\0');
+  // No environment overrides.
+  plan.push_back('\0');
+
+  if (plan.size() >= LAUNCH_PLAN_MAX_SIZE) return;
+
+  fs::path planPath = dest / LAUNCH_PLAN_FILE;
+  fs::path tempPath = dest / LAUNCH_PLAN_FILE ".tmp";
+
+  std::error_code ec;
+  fs::create_directory(dest, ec);
+
+  FILE *file = fopen(tempPath.c_str(), "wb");
+  if (!file) return;
+
+  bool written = fwrite(plan.data(), 1, plan.size(), file) == plan.size();
+  written = fclose(file) == 0 && written;
+
+  if (written) fs::rename(tempPath, planPath, ec);
+  if (!written || ec) fs::remove(tempPath, ec);
+#endif
+}
+
+// URLs of `file` in the release of `electronVersion` on each mirror of the
+// `release_mirrors` setting.
+std::vector<std::string> releaseUrls(const std::string &file) {
+  std::vector<std::string> urls;
+  for (std::string mirror : getConfigList("release_mirrors", RELEASES_URL)) {
+    if (mirror.back() != '/') mirror += '/';
+    urls.push_back(mirror + "v" + electronVersion + "/" + file);
+  }
+
+  return urls;
+}
+
+// Opens a connection to each release mirror while the version is resolved,
+// so the download starts on warm connections from the shared pool.
+void preconnectReleases() {
+  CURLM *multi = curl_multi_init();
+  if (!multi) return;
+
+  std::vector<std::string> urls =
+      getConfigList("release_mirrors", RELEASES_URL);
+  std::vector<CURL *> transfers;
+
+  for (const std::string &url : urls) {
+    CURL *curl = url.compare(0, 7, "file://") != 0 ? curl_easy_init() : nullptr;
+    transfers.push_back(curl);
+    if (!curl) continue;
+
+    setTransferDefaults(curl);
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, true);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, false);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, PRECONNECT_TIMEOUT);
+    curl_multi_add_handle(multi, curl);
+  }
+
+  uint64_t start = traceNow();
+
+  int running = 0;
+  do {
+    if (curl_multi_perform(multi, &running) != CURLM_OK) break;
+    if (running > 0) curl_multi_wait(multi, nullptr, 0, 1000, nullptr);
+  } while (running > 0);
+
+  for (size_t i = 0; i < urls.size(); i++) {
+    if (!transfers[i]) continue;
+
+    traceTransfer(transfers[i], urls[i].c_str(), start);
+    curl_multi_remove_handle(multi, transfers[i]);
+    curl_easy_cleanup(transfers[i]);
+  }
+
+  curl_multi_cleanup(multi);
+}
+
+// Reports an error and returns false unless the disk of the store has room
+// for the extracted `entries` and, if `archiveSize` is not 0, for what the
+// part of the archive does not hold yet.
+static bool checkSpace(const std::vector<ArchiveEntry> &entries,
+                       uint64_t archiveSize) {
+  uint64_t needed = 0;
+  for (const ArchiveEntry &entry : entries) needed += entry.size;
+
+  // A part being resumed already holds its space.
+  std::error_code ec;
+  uint64_t part = fs::file_size(zipPath.string() + PART_SUFFIX, ec);
+  if (!ec && part < archiveSize) needed += archiveSize - part;
+  if (ec) needed += archiveSize;
+
+  fs::space_info space = fs::space(binPath, ec);
+  if (ec || space.available >= needed) return true;
+
+  error("Not enough disk space to install Electron %s\n"
+        "%llu MB needed, %llu MB available",
+        electronVersion.c_str(), (unsigned long long)(needed >> 20),
+        (unsigned long long)(space.available >> 20));
+  return false;
+}
+
+// Downloads and extracts `electronVersion` into `dest`. Returns false after
+// reporting an error, or without one if it was mispredicted.
+bool installRelease() {
+  std::string archive = "electron-v" + electronVersion + "-" OS "-" ARCH ".zip";
+  std::vector<std::string> urls = releaseUrls(archive);
   zipPath = binPath / "electron.zip";
 
-  fs::create_directory(dest);
+  // A pinned release is only fetched from mirrors that were set up.
+  if (!manifest.url.empty()) {
+    if (getConfig("release_mirrors").empty()) urls.clear();
+    urls.push_back(manifest.url);
+  }
 
-  if (!download(url, zipPath.string().c_str())) {
-    return;
+  // A pinned release comes with its checksum, otherwise it is fetched while
+  // the archive downloads.
+  std::future<Checksum> checksums;
+  if (manifest.sha256.empty()) {
+    checksums = std::async(std::launch::async, fetchMirroredChecksum,
+                           releaseUrls("SHASUMS256.txt"), archive);
+  }
+
+  std::error_code ec;
+  fs::remove_all(staging, ec);
+  fs::create_directory(staging, ec);
+
+  // Entries are extracted while the archive downloads, which needs the
+  // central directory up front.
+  std::vector<ArchiveEntry> entries;
+  uint64_t size = 0;
+  bool streamed = false;
+  for (const std::string &url : urls) {
+    streamed = fetchCentralDirectory(url, &entries, &size);
+    if (streamed) break;
+  }
+
+  // Skipped entries are downloaded and hashed, but neither inflated nor
+  // written.
+  applyExtractProfile(extractProfile(), &entries);
+
+  if (streamed && !manifest.url.empty() && size != manifest.size) {
+    clean();
+    error("The archive does not match the pinned Electron %s",
+          manifest.version.c_str());
+    return false;
+  }
+
+  uint64_t start = traceNow();
+  std::unique_ptr<ArchiveExtractor> extractor(
+      streamed ? new ArchiveExtractor(staging, entries) : nullptr);
+
+  // Such an archive is only kept on disk to be resumed, so one that fits the
+  // budget skips the disk.
+  bool inMemory =
+      streamed &&
+      size <= (uint64_t)getConfigNumber("memory_budget_mb", MEMORY_BUDGET)
+                  << 20;
+
+  // Fails before the download rather than halfway through extracting.
+  if (streamed && !checkSpace(entries, inMemory ? 0 : size)) {
+    clean();
+    return false;
+  }
+
+  std::string digest;
+  uint64_t downloaded = 0;
+  if (!download(urls, zipPath.string().c_str(), extractor.get(), inMemory,
+                &digest, &downloaded)) {
+    return false;
+  }
+
+  saveTlsSessions();
+
+  // Entries still being extracted are waited for before anything is removed.
+  bool finished = streamed && extractor->finish();
+
+  // A prediction is not installed before it is confirmed.
+  if (!confirmPrediction(true)) return false;
+
+  if (!manifest.url.empty() && downloaded != manifest.size) {
+    clean();
+    error("The downloaded archive does not match the pinned Electron %s",
+          manifest.version.c_str());
+    return false;
+  }
+
+  // Entries extracted so far stay in the staging directory unless the
+  // archive is intact.
+  Checksum checksum;
+  if (checksums.valid()) {
+    checksum = checksums.get();
+  } else {
+    checksum.status = Checksum::FOUND;
+    checksum.hash = manifest.sha256;
+  }
+
+  // Only a release that publishes no checksum at all goes unverified, one
+  // that could not be fetched might have been withheld.
+  const std::string &expected = checksum.hash;
+  if (checksum.status == Checksum::UNAVAILABLE) {
+    clean();
+    error("Could not verify the downloaded Electron archive\n%s",
+          checksum.reason.c_str());
+    return false;
+  } else if (checksum.status == Checksum::UNPUBLISHED) {
+    std::cout << "No checksum published for " << archive
+              << ", skipping verification" << std::endl;
+  } else if (digest != expected) {
+    clean();
+    error("The downloaded Electron archive is corrupt\nSHA-256 %s, expected %s",
+          digest.c_str(), expected.c_str());
+    return false;
+  }
+
+  bool extracted;
+  if (streamed) {
+    extracted = finished;
+  } else {
+    setStatus("Extracting Electron...");
+
+    std::cout << "Extracting..." << std::endl;
+
+    extracted = extractDownloaded(&extractor);
   }
 
-  setStatus("Extracting Electron...");
+  traceEvent("extract", start, traceNow(), zipPath.string().c_str());
 
-  std::cout << "Extracting..." << std::endl;
+  if (extracted) extracted = writeExtractProfile(staging, extractProfile());
 
-  if (!extract(zipPath, dest)) {
+  if (extracted) {
+    fs::remove_all(dest, ec);
+    fs::rename(staging, dest, ec);
+    extracted = !ec;
+  }
+
+  if (!extracted) {
+    std::string reason = extractor ? extractor->error() : "";
     clean();
     error(
         "An error occurred extracting the downloaded Electron "
-        "archive");
-    return;
+        "archive\n%s",
+        reason.c_str());
+    return false;
   }
 
   fs::remove(zipPath);
+  return true;
+}
+
+void downloadThread(void) {
+  // A mispredicted release starts over with the resolved one.
+  while (!installRelease()) {
+    if (!mispredicted) return;
+
+    mispredicted = false;
+  }
+
+  writeLaunchPlan();
 
   std::cout << "Launching Electron..." << std::endl;
 
@@ -360,6 +852,116 @@ void downloadThread(void) {
   exit(0);
 }
 
+// Decides what to launch for a major that is not installed in `dest`: either
+// sets `runtime` to an install of the major elsewhere in the store, or
+// `electronVersion` to the release to download. Otherwise the `resolve`
+// setting picks how:
+//
+//   offline-first  reuse the newest install of the major unless the registry
+//                  names a newer release within `resolve_budget_ms`
+//   offline        reuse an install without asking the registry
+//   online         always download the newest release
+//
+// Returns false if neither works out, after reporting an error.
+bool resolveRuntime(const std::string &major) {
+  unsigned majorNumber = (unsigned)strtoul(major.c_str(), nullptr, 10);
+
+  uint64_t start = traceNow();
+
+  std::string mode = getConfig("resolve", "offline-first");
+
+  Install local;
+  bool hasLocal =
+      mode != "online" && findNewestInstall(binPath, majorNumber, &local);
+
+  traceEvent("install lookup", start, traceNow(),
+             hasLocal ? local.path.string().c_str() : nullptr);
+
+  if (!hasLocal) {
+    if (mode == "offline") {
+      error("Electron %s is not installed and resolve is set to offline",
+            major.c_str());
+      return false;
+    }
+
+    // With a cached version list the release is predicted and downloads
+    // while the registry confirms it. Otherwise the connection to the
+    // release host is opened while waiting for the registry.
+    std::string predicted = getCachedVersion(major, binPath);
+    if (!predicted.empty()) {
+      electronVersion = predicted;
+
+      // Detached, so that exiting on an error does not wait for it.
+      std::shared_ptr<std::promise<std::string>> resolved =
+          std::make_shared<std::promise<std::string>>();
+      resolution = resolved->get_future();
+
+      std::thread([major, resolved]() {
+        resolved->set_value(
+            getMatchingVersion(major, binPath, SPECULATION_BUDGET, true));
+      }).detach();
+
+      return true;
+    }
+
+    std::future<void> preconnect =
+        std::async(std::launch::async, preconnectReleases);
+
+    electronVersion = getMatchingVersion(major, binPath, 0, true);
+
+    if (electronVersion == "") {
+      error("Invalid Electron version");
+      return false;
+    }
+
+    return true;
+  }
+
+  long budget = mode == "offline"
+                    ? 0
+                    : getConfigNumber("resolve_budget_ms", RESOLVE_BUDGET);
+
+  if (budget > 0) {
+    // The launch waits no longer than the budget. A version list still
+    // downloading then goes on in the background, detached like the
+    // prediction above, and is cached if it completes before the launch
+    // replaces the process, otherwise the next launch asks again.
+    std::shared_ptr<std::promise<std::string>> resolved =
+        std::make_shared<std::promise<std::string>>();
+    std::future<std::string> lookup = resolved->get_future();
+    fs::path store = binPath;
+
+    std::thread([major, store, budget, resolved]() {
+      resolved->set_value(getMatchingVersion(major, store, budget));
+    }).detach();
+
+    if (lookup.wait_for(std::chrono::milliseconds(budget)) ==
+        std::future_status::ready) {
+      std::string latest = lookup.get();
+
+      SemVer version;
+      if (parseSemVer(latest.data(), latest.size(), &version) &&
+          compareSemVer(version, local.version) > 0) {
+        electronVersion = latest;
+        return true;
+      }
+    }
+  }
+
+  runtime = local.path;
+  return true;
+}
+
+// Downloads the release the dist pins into `dest`, the directory named
+// after it. Installs of that release elsewhere in the store are not reused,
+// so that the launch plan in `dest` can only ever start the pinned release.
+static void resolvePinned(const std::string &version) {
+  Manifest pinned;
+  if (readManifest(version, &pinned)) manifest = pinned;
+
+  electronVersion = version;
+}
+
 void initUI() {
   uiInitOptions options;
   memset(&options, 0, sizeof(uiInitOptions));
@@ -396,31 +998,66 @@ void initUI() {
 }
 
 int main() {
-  std::ifstream ifstream(ELECTRON_VERSION_PATH);
+  traceInit("installer");
+
+  uint64_t start = traceNow();
+
+  char versionBuffer[MAX_VERSION_LENGTH];
+  if (!readVersion(versionBuffer, sizeof(versionBuffer))) {
+    std::cout << "Invalid Electron version in " ELECTRON_VERSION_PATH
+              << std::endl;
+    return 1;
+  }
 
+  // Either a major or a release the dist pins, see readVersion().
+  std::string version = versionBuffer;
   std::string major =
-      std::string(1, std::string((std::istreambuf_iterator<char>(ifstream)),
-                                 std::istreambuf_iterator<char>())[0]);
+      version.substr(0, version.find_first_not_of("0123456789"));
+  bool pinned = version != major;
+
+  traceEvent("read version file", start, traceNow(), versionBuffer);
+
+  start = traceNow();
 
   binPath = getHomePath(BIN_DIR);
-  dest = binPath / major;
+  dest = binPath / version;
+  // Dot directories are not taken for installs, see install_index.hpp.
+  staging = binPath / ("." + version + ".staging");
 
   if (!fs::exists(binPath)) fs::create_directory(binPath);
 
-  if (!fs::exists(dest)) {
-    electronVersion = getMatchingVersion(major);
+  runtime = dest;
+  bool installed = fs::exists(dest / ELECTRON_EXECUTABLE);
 
-    if (electronVersion == "") {
-      error("Invalid Electron version");
+  // Only the pinned release itself may be launched for a pin.
+  Install current;
+  if (installed && pinned) {
+    installed = readInstall(dest, &current) && current.name == version;
+  }
+
+  traceEvent("store lookup", start, traceNow(), dest.string().c_str());
+
+  if (!installed) {
+    initTransfers(binPath);
+
+    if (pinned) {
+      resolvePinned(version);
+    } else if (!resolveRuntime(major)) {
       return 1;
     }
 
+    installed = electronVersion.empty();
+  }
+
+  if (!installed) {
     initUI();
 
     std::thread thread(downloadThread);
 
     uiMain();
   } else {
+    if (!fs::exists(dest / LAUNCH_PLAN_FILE)) writeLaunchPlan();
+
     std::cout << "Launching Electron..." << std::endl;
     int result = launchElectron();
 
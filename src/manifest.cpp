@@ -0,0 +1,71 @@
+#include "manifest.hpp"
+
+#include <fstream>
+#include <iterator>
+
+#include "lib/rapidjson/include/rapidjson/document.h"
+#include "platform.hpp"
+
+static bool readString(const rapidjson::Value &object, const char *name,
+                       std::string *value) {
+  rapidjson::Value::ConstMemberIterator member = object.FindMember(name);
+  if (member == object.MemberEnd() || !member->value.IsString()) return false;
+
+  value->assign(member->value.GetString(), member->value.GetStringLength());
+  return !value->empty();
+}
+
+static bool isDigest(const std::string &text) {
+  if (text.size() != 64) return false;
+
+  for (char c : text) {
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+  }
+
+  return true;
+}
+
+bool readManifest(const std::string &version, Manifest *manifest) {
+  std::ifstream file(ELECTRON_MANIFEST_PATH, std::ios::binary);
+  if (!file) return false;
+
+  std::string data((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+
+  rapidjson::Document document;
+  document.Parse(data.c_str());
+  if (document.HasParseError() || !document.IsObject()) return false;
+
+  if (!readString(document, "version", &manifest->version) ||
+      manifest->version != version) {
+    return false;
+  }
+
+  rapidjson::Value::ConstMemberIterator artifacts =
+      document.FindMember("artifacts");
+  if (artifacts == document.MemberEnd() || !artifacts->value.IsObject()) {
+    return false;
+  }
+
+  rapidjson::Value::ConstMemberIterator artifact =
+      artifacts->value.FindMember(BUILDARCHSTRING);
+  if (artifact == artifacts->value.MemberEnd() ||
+      !artifact->value.IsObject()) {
+    return false;
+  }
+
+  rapidjson::Value::ConstMemberIterator size =
+      artifact->value.FindMember("size");
+  if (size == artifact->value.MemberEnd() || !size->value.IsUint64()) {
+    return false;
+  }
+  manifest->size = size->value.GetUint64();
+
+  if (!readString(artifact->value, "url", &manifest->url) ||
+      !readString(artifact->value, "sha256", &manifest->sha256) ||
+      !isDigest(manifest->sha256)) {
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,32 @@
+#ifndef ELECTRON_GLOBAL_MANIFEST_HPP
+#define ELECTRON_GLOBAL_MANIFEST_HPP
+
+#include <stdint.h>
+#include <string>
+
+// Release pinned by the dist step of tools/index.ts, which writes it to
+// ELECTRON_MANIFEST_PATH and names it in ELECTRON_VERSION_PATH:
+//
+//   {
+//     "version": "10.1.0",
+//     "artifacts": {
+//       "linux-x64": { "url": "...", "size": 71234567, "sha256": "..." },
+//       ...
+//     }
+//   }
+//
+// Artifacts are keyed by BUILDARCHSTRING.
+struct Manifest {
+  std::string version;
+  std::string url;
+  uint64_t size = 0;
+  // Lowercase hex digest of the archive.
+  std::string sha256;
+};
+
+// Reads the artifact of this platform from the manifest. Returns false if
+// there is no manifest, it does not pin the release `version` or has no
+// artifact for this platform, in which case `manifest` must not be used.
+bool readManifest(const std::string &version, Manifest *manifest);
+
+#endif  // ELECTRON_GLOBAL_MANIFEST_HPP
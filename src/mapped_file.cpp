@@ -0,0 +1,79 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const char *path, bool sequential) {
+  close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  // Views take no access hints.
+  (void)sequential;
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (!mapping) return false;
+
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    CloseHandle(mapping);
+    return false;
+  }
+
+  mapping_ = mapping;
+  data_ = (const unsigned char *)data;
+  size_ = (size_t)size.QuadPart;
+#else
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void *data =
+      mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) return false;
+
+  if (sequential) madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+  data_ = (const unsigned char *)data;
+  size_ = (size_t)info.st_size;
+#endif
+
+  return true;
+}
+
+void MappedFile::close() {
+  if (!data_) return;
+
+#ifdef _WIN32
+  UnmapViewOfFile(data_);
+  CloseHandle(mapping_);
+  mapping_ = nullptr;
+#else
+  munmap(const_cast<unsigned char *>(data_), size_);
+#endif
+
+  data_ = nullptr;
+  size_ = 0;
+}
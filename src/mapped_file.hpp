@@ -0,0 +1,31 @@
+#ifndef ELECTRON_GLOBAL_MAPPED_FILE_HPP
+#define ELECTRON_GLOBAL_MAPPED_FILE_HPP
+
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  MappedFile() {}
+  ~MappedFile() { close(); }
+
+  // `sequential` tells the kernel the file is read front to back, so it
+  // reads further ahead and drops the pages left behind first.
+  bool open(const char *path, bool sequential = false);
+  void close();
+
+  const unsigned char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+
+  const unsigned char *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void *mapping_ = nullptr;
+#endif
+};
+
+#endif  // ELECTRON_GLOBAL_MAPPED_FILE_HPP
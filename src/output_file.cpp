@@ -0,0 +1,149 @@
+#include "output_file.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+bool OutputFile::open(const char *path, bool keep, int mode) {
+  close();
+
+#ifdef _WIN32
+  HANDLE handle =
+      CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                  keep ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                  NULL);
+  if (handle == INVALID_HANDLE_VALUE) return false;
+
+  (void)mode;
+  handle_ = handle;
+#else
+  fd_ = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC | (keep ? 0 : O_TRUNC),
+               mode);
+  if (fd_ < 0) return false;
+#endif
+
+  return true;
+}
+
+#ifndef _WIN32
+bool OutputFile::openAt(int directory, const char *name, int mode) {
+  close();
+
+  fd_ = openat(directory, name, O_RDWR | O_CREAT | O_CLOEXEC | O_TRUNC, mode);
+  return fd_ >= 0;
+}
+#endif
+
+bool OutputFile::openMemory(const char *name) {
+  close();
+
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+  fd_ = memfd_create(name, MFD_CLOEXEC);
+  return fd_ >= 0;
+#else
+  (void)name;
+  return false;
+#endif
+}
+
+bool OutputFile::preallocate(uint64_t size) {
+#ifdef _WIN32
+  LARGE_INTEGER end;
+  end.QuadPart = (LONGLONG)size;
+
+  return SetFilePointerEx((HANDLE)handle_, end, NULL, FILE_BEGIN) &&
+         SetEndOfFile((HANDLE)handle_);
+#else
+#if defined(__linux__)
+  // Not every filesystem supports fallocate, ftruncate still sets the size.
+  if (fallocate(fd_, 0, 0, (off_t)size) == 0) return true;
+#elif defined(__APPLE__)
+  fstore_t store = {F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t)size, 0};
+  if (fcntl(fd_, F_PREALLOCATE, &store) < 0) {
+    store.fst_flags = F_ALLOCATEALL;
+    fcntl(fd_, F_PREALLOCATE, &store);
+  }
+#endif
+
+  return ftruncate(fd_, (off_t)size) == 0;
+#endif
+}
+
+bool OutputFile::write(const char *data, size_t length, uint64_t offset) {
+  while (length > 0) {
+#ifdef _WIN32
+    OVERLAPPED overlapped;
+    ZeroMemory(&overlapped, sizeof(overlapped));
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+    DWORD written = 0;
+    DWORD chunk = length > 0x40000000 ? 0x40000000 : (DWORD)length;
+    if (!WriteFile((HANDLE)handle_, data, chunk, &written, &overlapped)) {
+      return false;
+    }
+#else
+    ssize_t written = pwrite(fd_, data, length, (off_t)offset);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return false;
+#endif
+
+    data += written;
+    length -= (size_t)written;
+    offset += (uint64_t)written;
+  }
+
+  return true;
+}
+
+bool OutputFile::read(char *data, size_t length, uint64_t offset) {
+  while (length > 0) {
+#ifdef _WIN32
+    OVERLAPPED overlapped;
+    ZeroMemory(&overlapped, sizeof(overlapped));
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+    DWORD read = 0;
+    DWORD chunk = length > 0x40000000 ? 0x40000000 : (DWORD)length;
+    if (!ReadFile((HANDLE)handle_, data, chunk, &read, &overlapped) ||
+        read == 0) {
+      return false;
+    }
+#else
+    ssize_t read = pread(fd_, data, length, (off_t)offset);
+    if (read < 0 && errno == EINTR) continue;
+    if (read <= 0) return false;
+#endif
+
+    data += read;
+    length -= (size_t)read;
+    offset += (uint64_t)read;
+  }
+
+  return true;
+}
+
+bool OutputFile::close() {
+#ifdef _WIN32
+  if (!handle_) return true;
+
+  bool closed = CloseHandle((HANDLE)handle_) != 0;
+  handle_ = nullptr;
+#else
+  if (fd_ < 0) return true;
+
+  bool closed = ::close(fd_) == 0;
+  fd_ = -1;
+#endif
+
+  return closed;
+}
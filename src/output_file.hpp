@@ -0,0 +1,54 @@
+#ifndef ELECTRON_GLOBAL_OUTPUT_FILE_HPP
+#define ELECTRON_GLOBAL_OUTPUT_FILE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// File written at explicit offsets, so parts of it can arrive in any order.
+// Written parts can be read back while the file is still open.
+class OutputFile {
+ public:
+  OutputFile() {}
+  ~OutputFile() { close(); }
+
+  // Creates the file at `path`, truncating it unless `keep` is set. `mode`
+  // holds the permissions of a new file, less the umask, outside Windows.
+  bool open(const char *path, bool keep = false, int mode = 0644);
+
+#ifndef _WIN32
+  // Creates or truncates the file `name` in the directory open as
+  // `directory`, as open() does.
+  bool openAt(int directory, const char *name, int mode = 0644);
+#endif
+
+  // Creates an anonymous file in memory instead, named `name` only for
+  // debugging. Fails where there are none, which is anywhere but Linux.
+  bool openMemory(const char *name);
+
+  // Reserves `size` bytes up front and sets the file to that size, so ranges
+  // written out of order neither fragment the file nor fail halfway for lack
+  // of space.
+  bool preallocate(uint64_t size);
+
+  bool write(const char *data, size_t length, uint64_t offset);
+
+  bool read(char *data, size_t length, uint64_t offset);
+
+  bool close();
+
+#ifndef _WIN32
+  int descriptor() const { return fd_; }
+#endif
+
+ private:
+  OutputFile(const OutputFile &);
+  OutputFile &operator=(const OutputFile &);
+
+#ifdef _WIN32
+  void *handle_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+#endif  // ELECTRON_GLOBAL_OUTPUT_FILE_HPP
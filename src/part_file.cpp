@@ -0,0 +1,136 @@
+#include "part_file.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+
+#include "lib/filesystem.hpp"
+
+namespace fs = ghc::filesystem;
+
+bool readPartState(const char *path, PartState *state) {
+  std::ifstream file(path);
+
+  std::string line;
+  if (!std::getline(file, line) || line != PART_STATE_MAGIC) return false;
+
+  *state = PartState();
+
+  while (std::getline(file, line)) {
+    size_t space = line.find(' ');
+    if (space == std::string::npos) continue;
+
+    std::string key = line.substr(0, space);
+    std::string value = line.substr(space + 1);
+
+    if (key == "url") {
+      state->url = value;
+    } else if (key == "etag") {
+      state->etag = value;
+    } else if (key == "last-modified") {
+      state->lastModified = value;
+    } else if (key == "size") {
+      state->size = strtoull(value.c_str(), nullptr, 10);
+    } else if (key == "done") {
+      Range range;
+      if (sscanf(value.c_str(), "%" SCNu64 " %" SCNu64, &range.start,
+                 &range.end) != 2 ||
+          range.start >= range.end || range.end > state->size) {
+        return false;
+      }
+
+      addRange(&state->done, range);
+    }
+  }
+
+  return !state->url.empty() && state->size > 0;
+}
+
+bool writePartState(const char *path, const PartState &state) {
+  std::string tempPath = std::string(path) + ".tmp";
+
+  FILE *file = fopen(tempPath.c_str(), "wb");
+  if (!file) return false;
+
+  fprintf(file, PART_STATE_MAGIC "\nurl %s\n", state.url.c_str());
+  if (!state.etag.empty()) fprintf(file, "etag %s\n", state.etag.c_str());
+  if (!state.lastModified.empty()) {
+    fprintf(file, "last-modified %s\n", state.lastModified.c_str());
+  }
+  fprintf(file, "size %" PRIu64 "\n", state.size);
+
+  for (const Range &range : state.done) {
+    fprintf(file, "done %" PRIu64 " %" PRIu64 "\n", range.start, range.end);
+  }
+
+  bool written = !ferror(file);
+  written = fclose(file) == 0 && written;
+
+  std::error_code ec;
+  if (written) fs::rename(tempPath, path, ec);
+  if (!written || ec) {
+    fs::remove(tempPath, ec);
+    return false;
+  }
+
+  return true;
+}
+
+void addRange(std::vector<Range> *ranges, Range range) {
+  if (range.start >= range.end) return;
+
+  std::vector<Range> merged;
+  bool added = false;
+
+  for (const Range &existing : *ranges) {
+    if (existing.end < range.start) {
+      merged.push_back(existing);
+    } else if (range.end < existing.start) {
+      if (!added) merged.push_back(range);
+      merged.push_back(existing);
+      added = true;
+    } else {
+      range.start = existing.start < range.start ? existing.start : range.start;
+      range.end = existing.end > range.end ? existing.end : range.end;
+    }
+  }
+
+  if (!added) merged.push_back(range);
+
+  ranges->swap(merged);
+}
+
+void removeRange(std::vector<Range> *ranges, Range range) {
+  std::vector<Range> kept;
+
+  for (const Range &existing : *ranges) {
+    if (existing.end <= range.start || range.end <= existing.start) {
+      kept.push_back(existing);
+      continue;
+    }
+
+    if (existing.start < range.start) {
+      kept.push_back({existing.start, range.start});
+    }
+    if (range.end < existing.end) kept.push_back({range.end, existing.end});
+  }
+
+  ranges->swap(kept);
+}
+
+std::vector<Range> missingRanges(const std::vector<Range> &ranges,
+                                 uint64_t size) {
+  std::vector<Range> missing;
+  uint64_t offset = 0;
+
+  for (const Range &range : ranges) {
+    if (range.start > offset) missing.push_back({offset, range.start});
+    if (range.end > offset) offset = range.end;
+  }
+
+  if (offset < size) missing.push_back({offset, size});
+
+  return missing;
+}
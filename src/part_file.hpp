@@ -0,0 +1,57 @@
+#ifndef ELECTRON_GLOBAL_PART_FILE_HPP
+#define ELECTRON_GLOBAL_PART_FILE_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Downloads are written to `<file>.part` and renamed once complete. While
+// they are incomplete, a sidecar `<file>.part.state` records where the data
+// came from and which bytes of the part have been written, so an interrupted
+// download resumes with range requests instead of starting over:
+//
+//   PART_STATE_MAGIC
+//   url <url>
+//   etag <etag>
+//   last-modified <date>
+//   size <bytes>
+//   done <start> <end>
+//   ...
+#define PART_SUFFIX ".part"
+#define PART_STATE_SUFFIX ".part.state"
+#define PART_STATE_MAGIC "EGPART1"
+
+// Bytes [start, end) of a file.
+struct Range {
+  uint64_t start;
+  uint64_t end;
+};
+
+struct PartState {
+  // Mirror the part was fetched from.
+  std::string url;
+  // Validators of the response the part was fetched from, sent back in
+  // If-Range so a changed file is downloaded again as a whole.
+  std::string etag;
+  std::string lastModified;
+  uint64_t size = 0;
+  // Written ranges, sorted and merged.
+  std::vector<Range> done;
+};
+
+bool readPartState(const char *path, PartState *state);
+
+// Atomically replaces the state file at `path`.
+bool writePartState(const char *path, const PartState &state);
+
+// Adds `range` to the sorted and merged `ranges`.
+void addRange(std::vector<Range> *ranges, Range range);
+
+// Removes `range` from the sorted and merged `ranges`.
+void removeRange(std::vector<Range> *ranges, Range range);
+
+// Ranges of [0, size) that the sorted and merged `ranges` do not cover.
+std::vector<Range> missingRanges(const std::vector<Range> &ranges,
+                                 uint64_t size);
+
+#endif  // ELECTRON_GLOBAL_PART_FILE_HPP
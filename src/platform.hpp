@@ -0,0 +1,57 @@
+#ifndef ELECTRON_GLOBAL_PLATFORM_HPP
+#define ELECTRON_GLOBAL_PLATFORM_HPP
+
+#define PROGRAM_NAME "electron-launcher"
+#define PROGRAM_VERSION "0.1"
+
+#define BIN_DIR ".electron-global"
+
+#if defined(WIN32) || defined(_WIN32)
+#define OS "win32"
+#define HOME_ENV "HOMEPATH"
+#define PATH_SEPARATOR "\\"
+#define ELECTRON_VERSION_PATH "electron_version"
+#define ELECTRON_MANIFEST_PATH "electron_manifest.json"
+#define ASAR_PATH "resources/app.asar"
+#define ELECTRON_EXECUTABLE "electron.exe"
+#define INSTALLER_PATH "electron-installer.exe"
+#elif defined(__APPLE__)
+#define OS "darwin"
+#define HOME_ENV "HOME"
+#define PATH_SEPARATOR "/"
+#define ELECTRON_VERSION_PATH "../Resources/electron_version"
+#define ELECTRON_MANIFEST_PATH "../Resources/electron_manifest.json"
+#define ASAR_PATH "../Resources/app.asar"
+#define ELECTRON_EXECUTABLE "Electron.app/Contents/MacOS/Electron"
+#define INSTALLER_PATH "electron-installer"
+#elif defined(__linux__)
+#define OS "linux"
+#define HOME_ENV "HOME"
+#define PATH_SEPARATOR "/"
+#define ELECTRON_VERSION_PATH "electron_version"
+#define ELECTRON_MANIFEST_PATH "electron_manifest.json"
+#define ASAR_PATH "resources/app.asar"
+#define ELECTRON_EXECUTABLE "electron"
+#define INSTALLER_PATH "electron-installer"
+#else
+#error OS not detected
+#endif
+
+#if defined(__i386__) || (defined(_WIN32) && !defined(_WIN64))
+#define ARCH "ia32"
+#elif defined(__x86_64__) || defined(_WIN64)
+#define ARCH "x64"
+#elif defined(__ARM_ARCH_7__)
+#define ARCH "armv7l"
+#elif defined(__aarch64__)
+#define ARCH "arm64"
+#else
+#error CPU architecture not detected
+#endif
+
+#define BUILDARCHSTRING OS "-" ARCH
+
+// Longest version string accepted from ELECTRON_VERSION_PATH.
+#define MAX_VERSION_LENGTH 64
+
+#endif  // ELECTRON_GLOBAL_PLATFORM_HPP
@@ -0,0 +1,437 @@
+#include "registry.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+#include "config.hpp"
+#include "installer.hpp"
+#include "lib/rapidjson/include/rapidjson/reader.h"
+#include "trace.hpp"
+#include "version_index.hpp"
+
+// Abbreviated "corgi" metadata only holds what installs need, a fraction of
+// the full packument with every README and manifest.
+#define REGISTRY_URL "https://registry.npmjs.org/electron"
+#define REGISTRY_ACCEPT \
+  "application/vnd.npm.install-v1+json; q=1.0, application/json; q=0.8"
+// Seconds a response that already started may go below 1 KiB/s before it
+// is abandoned, whatever the budget.
+#define REGISTRY_STALL_TIME 10
+
+namespace fs = ghc::filesystem;
+
+// rapidjson input stream that pulls the response body from libcurl on
+// demand. Only the chunk being parsed is kept in memory and the transfer is
+// paused until the parser has consumed it, so parsing overlaps with the
+// network transfer and memory use does not depend on the document size.
+//
+// The same request goes to every mirror in the multi handle. The first to
+// answer is read and the others are cancelled.
+class TransferStream {
+ public:
+  typedef char Ch;
+
+  explicit TransferStream(CURLM *multi) : multi_(multi) {}
+
+  // Adds the request to one more mirror, already in the multi handle.
+  void add(CURL *curl) { transfers_.push_back(curl); }
+
+  // Gives up unless a mirror answered within `budget` milliseconds. A
+  // response that started in time is read to the end.
+  void setBudget(long budget) {
+    deadline_ = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(budget);
+    bounded_ = true;
+  }
+
+  // Called once a mirror received the headers of a successful response.
+  void answered() { answered_ = true; }
+
+  Ch Peek() const {
+    return cursor_ < chunk_.size() || fill() ? chunk_[cursor_] : '\0';
+  }
+
+  Ch Take() {
+    Ch c = Peek();
+    if (c) cursor_++;
+    return c;
+  }
+
+  size_t Tell() const { return consumed_ + cursor_; }
+
+  // Write-only part of the stream concept, never used by the reader.
+  Ch *PutBegin() { return nullptr; }
+  void Put(Ch) {}
+  void Flush() {}
+  size_t PutEnd(Ch *) { return 0; }
+
+  size_t receive(CURL *curl, const char *data, size_t length) {
+    if (!curl_) curl_ = curl;
+    if (curl != curl_) return 0;
+
+    // Hold the transfer back until the parser is done with the last chunk.
+    if (cursor_ < chunk_.size()) {
+      paused_ = true;
+      return CURL_WRITEFUNC_PAUSE;
+    }
+
+    consumed_ += chunk_.size();
+    chunk_.assign(data, length);
+    cursor_ = 0;
+
+    return length;
+  }
+
+  // Result of the transfer, CURLE_OK if it is still running.
+  CURLcode result() const {
+    collect();
+    return result_;
+  }
+
+  // Transfer that answered first, null while none did.
+  CURL *winner() const { return curl_; }
+
+ private:
+  // Reads the finished transfers. One that succeeds without a body, as on a
+  // 304, also wins the race.
+  void collect() const {
+    int queued;
+    CURLMsg *message;
+    while ((message = curl_multi_info_read(multi_, &queued))) {
+      if (message->msg != CURLMSG_DONE) continue;
+
+      if (!curl_ && message->data.result == CURLE_OK) {
+        curl_ = message->easy_handle;
+      }
+
+      if (message->easy_handle == curl_) {
+        result_ = message->data.result;
+        done_ = true;
+      } else if (!curl_) {
+        // Failed before any other mirror answered.
+        result_ = message->data.result;
+        if (++failed_ == transfers_.size()) done_ = true;
+      }
+    }
+  }
+
+  // Cancels the mirrors that lost the race.
+  void dropLosers() const {
+    if (!curl_ || dropped_) return;
+
+    for (CURL *curl : transfers_) {
+      if (curl != curl_) curl_multi_remove_handle(multi_, curl);
+    }
+    dropped_ = true;
+  }
+
+  bool fill() const {
+    consumed_ += chunk_.size();
+    chunk_.clear();
+    cursor_ = 0;
+
+    if (paused_) {
+      paused_ = false;
+      curl_easy_pause(curl_, CURLPAUSE_CONT);
+    }
+
+    while (chunk_.empty() && !done_) {
+      int running = 0;
+      if (curl_multi_perform(multi_, &running) != CURLM_OK) running = 0;
+
+      collect();
+      dropLosers();
+
+      if (!chunk_.empty()) break;
+
+      if (!running) {
+        done_ = true;
+        break;
+      }
+
+      int timeout = 1000;
+      if (bounded_ && !answered_ && !curl_) {
+        long left = (long)std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline_ - std::chrono::steady_clock::now())
+                        .count();
+        if (left <= 0) {
+          result_ = CURLE_OPERATION_TIMEDOUT;
+          done_ = true;
+          break;
+        }
+        if (left < timeout) timeout = (int)left;
+      }
+
+      curl_multi_wait(multi_, nullptr, 0, timeout, nullptr);
+    }
+
+    return !chunk_.empty();
+  }
+
+  CURLM *multi_;
+  std::vector<CURL *> transfers_;
+  mutable CURL *curl_ = nullptr;
+  mutable size_t failed_ = 0;
+  mutable bool dropped_ = false;
+  mutable std::string chunk_;
+  mutable size_t cursor_ = 0;
+  mutable size_t consumed_ = 0;
+  mutable bool paused_ = false;
+  mutable bool done_ = false;
+  mutable CURLcode result_ = CURLE_OK;
+  bool bounded_ = false;
+  bool answered_ = false;
+  std::chrono::steady_clock::time_point deadline_;
+};
+
+// Validators of the registry response, stored in the version index so the
+// next resolution can be answered by a 304.
+struct Validators {
+  std::string etag;
+  std::string lastModified;
+};
+
+// Request to one registry mirror.
+struct RegistryMirror {
+  std::string url;
+  CURL *curl = nullptr;
+  TransferStream *stream = nullptr;
+  Validators fresh;
+};
+
+static size_t onWrite(const char *contents, size_t size, size_t nmemb,
+                      void *userp) {
+  RegistryMirror *mirror = (RegistryMirror *)userp;
+  return mirror->stream->receive(mirror->curl, contents, size * nmemb);
+}
+
+// SAX handler that collects the keys of the top-level "versions" object and
+// stops the parser as soon as that object ends. Every other value is skipped
+// without being stored.
+struct VersionHandler
+    : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, VersionHandler> {
+  bool Default() { return true; }
+
+  bool StartObject() {
+    depth++;
+    if (depth == 2 && atVersions) inVersions = true;
+    return true;
+  }
+
+  bool EndObject(rapidjson::SizeType) {
+    if (inVersions && depth == 2) {
+      complete = true;
+      return false;
+    }
+
+    depth--;
+    return true;
+  }
+
+  bool StartArray() {
+    depth++;
+    return true;
+  }
+
+  bool EndArray(rapidjson::SizeType) {
+    depth--;
+    return true;
+  }
+
+  bool Key(const char *name, rapidjson::SizeType length, bool) {
+    if (depth == 1) {
+      atVersions = length == 8 && memcmp(name, "versions", 8) == 0;
+    } else if (inVersions && depth == 2) {
+      versions.push_back(std::string(name, length));
+    }
+
+    return true;
+  }
+
+  std::vector<std::string> versions;
+  int depth = 0;
+  bool atVersions = false;
+  bool inVersions = false;
+  bool complete = false;
+};
+
+static size_t onHeader(const char *contents, size_t size, size_t nmemb,
+                       void *userp) {
+  RegistryMirror *mirror = (RegistryMirror *)userp;
+  Validators *validators = &mirror->fresh;
+  size_t length = size * nmemb;
+
+  // Validators of redirect responses must not stick.
+  if (length > 5 && memcmp(contents, "HTTP/", 5) == 0) {
+    validators->etag.clear();
+    validators->lastModified.clear();
+  } else if (length <= 2 && (contents[0] == '\r' || contents[0] == '\n')) {
+    // End of the headers, of a redirect or of the actual answer.
+    long status = 0;
+    curl_easy_getinfo(mirror->curl, CURLINFO_RESPONSE_CODE, &status);
+    if ((status >= 200 && status < 300) || status == 304) {
+      mirror->stream->answered();
+    }
+  } else if (!readHeader(contents, length, "etag", &validators->etag)) {
+    readHeader(contents, length, "last-modified", &validators->lastModified);
+  }
+
+  return length;
+}
+
+// Atomically replaces the index file at `path` with `data`.
+static void writeIndex(const fs::path &path, const std::string &data) {
+  fs::path tempPath = path.string() + ".tmp";
+
+  {
+    std::ofstream file(tempPath.string().c_str(),
+                       std::ios::binary | std::ios::trunc);
+    if (!file) return;
+
+    if (!file.write(data.data(), data.size()).flush()) {
+      file.close();
+      fs::remove(tempPath);
+      return;
+    }
+  }
+
+  std::error_code ec;
+  fs::rename(tempPath, path, ec);
+  if (ec) fs::remove(tempPath, ec);
+}
+
+std::string getMatchingVersion(const std::string &major,
+                               const fs::path &store, long budget,
+                               bool concurrent) {
+  unsigned majorNumber = (unsigned)strtoul(major.c_str(), nullptr, 10);
+  fs::path indexPath = store / VERSION_INDEX_FILE;
+
+  VersionIndex cached;
+  bool hasCache = cached.open(indexPath.string().c_str());
+
+  std::vector<std::string> urls =
+      getConfigList("registry_mirrors", REGISTRY_URL);
+
+  CURLM *multi = curl_multi_init();
+  if (!multi) {
+    error("Error initializing libcurl");
+    return "";
+  }
+
+  TransferStream stream(multi);
+  if (budget > 0) stream.setBudget(budget);
+
+  // The validators of one mirror mean nothing to another, which then
+  // answers in full.
+  struct curl_slist *headers =
+      curl_slist_append(nullptr, "Accept: " REGISTRY_ACCEPT);
+  if (hasCache && !cached.etag().empty()) {
+    headers = curl_slist_append(
+        headers, ("If-None-Match: " + cached.etag()).c_str());
+  }
+  if (hasCache && !cached.lastModified().empty()) {
+    headers = curl_slist_append(
+        headers, ("If-Modified-Since: " + cached.lastModified()).c_str());
+  }
+
+  std::vector<RegistryMirror> mirrors(urls.size());
+
+  for (size_t i = 0; i < urls.size(); i++) {
+    RegistryMirror &mirror = mirrors[i];
+    mirror.url = urls[i];
+    mirror.stream = &stream;
+    mirror.curl = curl_easy_init();
+    if (!mirror.curl) continue;
+
+    CURL *curl = mirror.curl;
+    setTransferDefaults(curl);
+    if (concurrent) curl_easy_setopt(curl, CURLOPT_SHARE, nullptr);
+    curl_easy_setopt(curl, CURLOPT_URL, mirror.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, true);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, onHeader);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &mirror);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, onWrite);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &mirror);
+    // Covers name resolution too, so an offline machine does not wait for
+    // the resolver to time out. Only the answer has to arrive within the
+    // budget, the version list then downloads in full so that it is cached.
+    if (budget > 0) {
+      curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, budget);
+      curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1024);
+      curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, REGISTRY_STALL_TIME);
+    }
+
+    curl_multi_add_handle(multi, curl);
+    stream.add(curl);
+  }
+
+  uint64_t start = traceNow();
+
+  VersionHandler handler;
+  rapidjson::Reader reader;
+  reader.Parse<rapidjson::kParseDefaultFlags>(stream, handler);
+
+  CURLcode response = stream.result();
+
+  // Reported as the first mirror if none answered.
+  const RegistryMirror *winner = &mirrors[0];
+  for (const RegistryMirror &mirror : mirrors) {
+    if (mirror.curl && mirror.curl == stream.winner()) winner = &mirror;
+  }
+
+  long status = 0;
+  if (winner->curl) {
+    curl_easy_getinfo(winner->curl, CURLINFO_RESPONSE_CODE, &status);
+    traceTransfer(winner->curl, winner->url.c_str(), start);
+  } else if (response == CURLE_OK) {
+    response = CURLE_FAILED_INIT;
+  }
+
+  for (const RegistryMirror &mirror : mirrors) {
+    if (!mirror.curl) continue;
+
+    curl_multi_remove_handle(multi, mirror.curl);
+    curl_easy_cleanup(mirror.curl);
+  }
+  curl_multi_cleanup(multi);
+  curl_slist_free_all(headers);
+
+  std::string version;
+
+  if (response == CURLE_OK && status == 304 && hasCache) {
+    version = cached.findNewest(majorNumber);
+    traceEvent("registry resolve", start, traceNow(), "not modified");
+  } else if (handler.complete) {
+    std::string data = VersionIndex::build(
+        handler.versions, winner->fresh.etag, winner->fresh.lastModified);
+    writeIndex(indexPath, data);
+
+    VersionIndex index;
+    if (index.load((const unsigned char *)data.data(), data.size())) {
+      version = index.findNewest(majorNumber);
+    }
+    traceEvent("registry resolve", start, traceNow(), version.c_str());
+  } else if (response != CURLE_OK) {
+    if (budget > 0) {
+      traceEvent("registry resolve", start, traceNow(),
+                 curl_easy_strerror(response));
+    } else {
+      transferError(winner->url.c_str(), response);
+    }
+  }
+
+  return version;
+}
+
+std::string getCachedVersion(const std::string &major, const fs::path &store) {
+  VersionIndex cached;
+  if (!cached.open((store / VERSION_INDEX_FILE).string().c_str())) return "";
+
+  return cached.findNewest((unsigned)strtoul(major.c_str(), nullptr, 10));
+}
@@ -0,0 +1,34 @@
+#ifndef ELECTRON_GLOBAL_REGISTRY_HPP
+#define ELECTRON_GLOBAL_REGISTRY_HPP
+
+#include <string>
+
+#include "lib/filesystem.hpp"
+
+// Resolves `major` to a full Electron version using the npm registry. The
+// version list is cached in `store` and revalidated with a conditional
+// request, so unchanged metadata costs one round trip and no parsing.
+//
+// The request goes to every URL of the `registry_mirrors` setting at once,
+// and the first mirror to answer is read.
+// Returns an empty string if no version matches or the registry could not be
+// reached, in which case an error has already been reported.
+//
+// With a `budget` in milliseconds the lookup is abandoned unless a mirror
+// answers within it, and failures are not reported since the caller has a
+// runtime to fall back to. An answer that arrived in time is read to the
+// end, so the version list is cached however slow the link, and a caller
+// that cannot wait that long runs the lookup on a thread of its own.
+//
+// A `concurrent` lookup runs alongside other transfers, so it keeps its own
+// connections, see transferShare().
+std::string getMatchingVersion(const std::string &major,
+                               const ghc::filesystem::path &store,
+                               long budget = 0, bool concurrent = false);
+
+// What the last lookup of `major` resolved to according to the cached version
+// list, without contacting the registry. Empty if nothing is cached.
+std::string getCachedVersion(const std::string &major,
+                             const ghc::filesystem::path &store);
+
+#endif  // ELECTRON_GLOBAL_REGISTRY_HPP
@@ -0,0 +1,124 @@
+#include "semver.hpp"
+
+#include <limits.h>
+#include <string.h>
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+static bool isIdentifierChar(char c) {
+  return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         c == '-';
+}
+
+// Parses a numeric component without leading zeros.
+static bool parseNumber(const char *&cursor, const char *end,
+                        unsigned *value) {
+  if (cursor == end || !isDigit(*cursor)) return false;
+  if (*cursor == '0' && cursor + 1 < end && isDigit(cursor[1])) return false;
+
+  unsigned long number = 0;
+  while (cursor < end && isDigit(*cursor)) {
+    number = number * 10 + (*cursor++ - '0');
+    if (number > UINT_MAX) return false;
+  }
+
+  *value = (unsigned)number;
+  return true;
+}
+
+bool parseSemVer(const char *text, size_t length, SemVer *version) {
+  const char *cursor = text, *end = text + length;
+
+  if (cursor < end && (*cursor == 'v' || *cursor == 'V')) cursor++;
+
+  if (!parseNumber(cursor, end, &version->major)) return false;
+  if (cursor == end || *cursor++ != '.') return false;
+  if (!parseNumber(cursor, end, &version->minor)) return false;
+  if (cursor == end || *cursor++ != '.') return false;
+  if (!parseNumber(cursor, end, &version->patch)) return false;
+
+  version->prerelease.clear();
+
+  if (cursor < end && *cursor == '-') {
+    const char *start = ++cursor;
+    bool emptyIdentifier = true;
+
+    while (cursor < end && *cursor != '+') {
+      if (*cursor == '.') {
+        if (emptyIdentifier) return false;
+        emptyIdentifier = true;
+      } else if (isIdentifierChar(*cursor)) {
+        emptyIdentifier = false;
+      } else {
+        return false;
+      }
+      cursor++;
+    }
+
+    if (emptyIdentifier) return false;
+    version->prerelease.assign(start, cursor - start);
+  }
+
+  if (cursor < end && *cursor == '+') {
+    if (++cursor == end) return false;
+    while (cursor < end && (isIdentifierChar(*cursor) || *cursor == '.')) {
+      cursor++;
+    }
+  }
+
+  return cursor == end;
+}
+
+// Compares one pre-release identifier: numeric identifiers numerically and
+// below alphanumeric ones, which are compared in ASCII order.
+static int compareIdentifier(const char *a, size_t aLength, const char *b,
+                             size_t bLength) {
+  bool aNumeric = true, bNumeric = true;
+  for (size_t i = 0; i < aLength; i++) aNumeric = aNumeric && isDigit(a[i]);
+  for (size_t i = 0; i < bLength; i++) bNumeric = bNumeric && isDigit(b[i]);
+
+  if (aNumeric && bNumeric) {
+    if (aLength != bLength) return aLength < bLength ? -1 : 1;
+    return memcmp(a, b, aLength);
+  }
+
+  if (aNumeric != bNumeric) return aNumeric ? -1 : 1;
+
+  int result = memcmp(a, b, aLength < bLength ? aLength : bLength);
+  if (result) return result;
+
+  return aLength == bLength ? 0 : (aLength < bLength ? -1 : 1);
+}
+
+int comparePrerelease(const std::string &a, const std::string &b) {
+  // A stable release has higher precedence than any of its pre-releases.
+  if (a.empty() || b.empty()) {
+    return a.empty() == b.empty() ? 0 : (a.empty() ? 1 : -1);
+  }
+
+  size_t aStart = 0, bStart = 0;
+
+  for (;;) {
+    size_t aEnd = a.find('.', aStart), bEnd = b.find('.', bStart);
+    if (aEnd == std::string::npos) aEnd = a.size();
+    if (bEnd == std::string::npos) bEnd = b.size();
+
+    int result = compareIdentifier(a.data() + aStart, aEnd - aStart,
+                                   b.data() + bStart, bEnd - bStart);
+    if (result) return result;
+
+    bool aDone = aEnd == a.size(), bDone = bEnd == b.size();
+    if (aDone || bDone) return aDone == bDone ? 0 : (aDone ? -1 : 1);
+
+    aStart = aEnd + 1;
+    bStart = bEnd + 1;
+  }
+}
+
+int compareSemVer(const SemVer &a, const SemVer &b) {
+  if (a.major != b.major) return a.major < b.major ? -1 : 1;
+  if (a.minor != b.minor) return a.minor < b.minor ? -1 : 1;
+  if (a.patch != b.patch) return a.patch < b.patch ? -1 : 1;
+
+  return comparePrerelease(a.prerelease, b.prerelease);
+}
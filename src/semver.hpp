@@ -0,0 +1,26 @@
+#ifndef ELECTRON_GLOBAL_SEMVER_HPP
+#define ELECTRON_GLOBAL_SEMVER_HPP
+
+#include <stddef.h>
+#include <string>
+
+struct SemVer {
+  unsigned major = 0;
+  unsigned minor = 0;
+  unsigned patch = 0;
+  // Dot separated pre-release identifiers, empty for stable releases.
+  std::string prerelease;
+};
+
+// Parses MAJOR.MINOR.PATCH[-PRERELEASE][+BUILD]. A leading "v" is accepted,
+// build metadata is dropped.
+bool parseSemVer(const char *text, size_t length, SemVer *version);
+
+// Compares by semver precedence: negative if `a` is older than `b`, zero if
+// they are equal and positive otherwise.
+int compareSemVer(const SemVer &a, const SemVer &b);
+
+// Compares only the pre-release parts of two otherwise equal versions.
+int comparePrerelease(const std::string &a, const std::string &b);
+
+#endif  // ELECTRON_GLOBAL_SEMVER_HPP
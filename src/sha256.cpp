@@ -0,0 +1,199 @@
+#include "sha256.hpp"
+
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SHA256_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+typedef void (*Sha256Blocks)(uint32_t state[8], const unsigned char *data,
+                             size_t blocks);
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static uint32_t rotate(uint32_t value, int bits) {
+  return (value >> bits) | (value << (32 - bits));
+}
+
+static void blocksPortable(uint32_t state[8], const unsigned char *data,
+                           size_t blocks) {
+  for (; blocks > 0; blocks--, data += SHA256_BLOCK_SIZE) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+      w[i] = (uint32_t)data[i * 4] << 24 | (uint32_t)data[i * 4 + 1] << 16 |
+             (uint32_t)data[i * 4 + 2] << 8 | data[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+      uint32_t s0 =
+          rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 =
+          rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+             e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 64; i++) {
+      uint32_t s1 = rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25);
+      uint32_t t1 = h + s1 + ((e & f) ^ (~e & g)) + K[i] + w[i];
+      uint32_t s0 = rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22);
+      uint32_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+#ifdef SHA256_X86
+// Four rounds at a time with the SHA extensions, which keep the state as
+// ABEF and CDGH.
+__attribute__((target("sha,sse4.1"))) static void blocksShaNi(
+    uint32_t state[8], const unsigned char *data, size_t blocks) {
+  const __m128i byteSwap =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  __m128i dcba = _mm_shuffle_epi32(
+      _mm_loadu_si128((const __m128i *)&state[0]), 0xb1);
+  __m128i hgfe = _mm_shuffle_epi32(
+      _mm_loadu_si128((const __m128i *)&state[4]), 0x1b);
+  __m128i abef = _mm_alignr_epi8(dcba, hgfe, 8);
+  __m128i cdgh = _mm_blend_epi16(hgfe, dcba, 0xf0);
+
+  for (; blocks > 0; blocks--, data += SHA256_BLOCK_SIZE) {
+    __m128i savedAbef = abef, savedCdgh = cdgh;
+    __m128i w[4];
+
+    for (int i = 0; i < 16; i++) {
+      if (i < 4) {
+        w[i] = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)(data + i * 16)), byteSwap);
+      } else {
+        // Words i * 4 to i * 4 + 3 from those 16, 15, 7 and 2 before.
+        __m128i words = _mm_add_epi32(
+            _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]),
+            _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+        w[i & 3] = _mm_sha256msg2_epu32(words, w[(i + 3) & 3]);
+      }
+
+      __m128i rounds = _mm_add_epi32(
+          w[i & 3], _mm_loadu_si128((const __m128i *)&K[i * 4]));
+      cdgh = _mm_sha256rnds2_epu32(cdgh, abef, rounds);
+      abef = _mm_sha256rnds2_epu32(abef, cdgh,
+                                   _mm_shuffle_epi32(rounds, 0x0e));
+    }
+
+    abef = _mm_add_epi32(abef, savedAbef);
+    cdgh = _mm_add_epi32(cdgh, savedCdgh);
+  }
+
+  __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+  __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+  _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(feba, dchg, 0xf0));
+  _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(dchg, feba, 8));
+}
+
+static bool hasShaNi() {
+  unsigned a, b, c, d;
+  if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSSE3) ||
+      !(c & bit_SSE4_1)) {
+    return false;
+  }
+
+  return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & (1 << 29));
+}
+#endif
+
+static Sha256Blocks selectBlocks() {
+#ifdef SHA256_X86
+  if (hasShaNi()) return blocksShaNi;
+#endif
+
+  return blocksPortable;
+}
+
+static const Sha256Blocks hashBlocks = selectBlocks();
+
+Sha256::Sha256() {
+  static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                      0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                      0x1f83d9ab, 0x5be0cd19};
+  memcpy(state_, initial, sizeof(state_));
+}
+
+void Sha256::update(const void *data, size_t length) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  length_ += length;
+
+  if (buffered_ > 0) {
+    size_t chunk = SHA256_BLOCK_SIZE - buffered_;
+    if (chunk > length) chunk = length;
+
+    memcpy(buffer_ + buffered_, bytes, chunk);
+    buffered_ += chunk;
+    bytes += chunk;
+    length -= chunk;
+
+    if (buffered_ < SHA256_BLOCK_SIZE) return;
+
+    hashBlocks(state_, buffer_, 1);
+    buffered_ = 0;
+  }
+
+  size_t blocks = length / SHA256_BLOCK_SIZE;
+  if (blocks > 0) hashBlocks(state_, bytes, blocks);
+
+  buffered_ = length % SHA256_BLOCK_SIZE;
+  memcpy(buffer_, bytes + blocks * SHA256_BLOCK_SIZE, buffered_);
+}
+
+std::string Sha256::finish() {
+  uint64_t bits = length_ * 8;
+
+  unsigned char padding[SHA256_BLOCK_SIZE * 2] = {0x80};
+  size_t paddingLength = (buffered_ < 56 ? 56 : 120) - buffered_;
+  for (int i = 0; i < 8; i++) {
+    padding[paddingLength + i] = (unsigned char)(bits >> (56 - i * 8));
+  }
+  update(padding, paddingLength + 8);
+
+  static const char digits[] = "0123456789abcdef";
+
+  std::string digest;
+  for (uint32_t word : state_) {
+    for (int shift = 28; shift >= 0; shift -= 4) {
+      digest.push_back(digits[(word >> shift) & 0xf]);
+    }
+  }
+
+  return digest;
+}
@@ -0,0 +1,28 @@
+#ifndef ELECTRON_GLOBAL_SHA256_HPP
+#define ELECTRON_GLOBAL_SHA256_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#define SHA256_BLOCK_SIZE 64
+
+// Incremental SHA-256, so a download can be hashed as it arrives. Blocks are
+// hashed with the SHA extensions of x86 processors that have them.
+class Sha256 {
+ public:
+  Sha256();
+
+  void update(const void *data, size_t length);
+
+  // Returns the digest as lowercase hex. The hash cannot be updated after.
+  std::string finish();
+
+ private:
+  uint32_t state_[8];
+  unsigned char buffer_[SHA256_BLOCK_SIZE];
+  size_t buffered_ = 0;
+  uint64_t length_ = 0;
+};
+
+#endif  // ELECTRON_GLOBAL_SHA256_HPP
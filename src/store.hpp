@@ -0,0 +1,133 @@
+#ifndef ELECTRON_GLOBAL_STORE_HPP
+#define ELECTRON_GLOBAL_STORE_HPP
+
+// Helpers shared by the launch stub and the installer. The stub is linked
+// without libstdc++, so everything in here must stick to the C library.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "platform.hpp"
+
+// Reads the version the app runs from ELECTRON_VERSION_PATH into `version`:
+// either a major like `12`, or the exact release the dist pins like `12.0.5`.
+// Either names the directory of the runtime in the store. Stops at the first
+// character a version cannot hold, so that trailing newlines written by
+// editors are ignored. Returns false if the file is missing or does not
+// start with a version.
+inline bool readVersion(char *version, size_t size) {
+  char buffer[MAX_VERSION_LENGTH];
+  long length;
+
+#ifdef _WIN32
+  FILE *file = fopen(ELECTRON_VERSION_PATH, "rb");
+  if (!file) return false;
+  length = (long)fread(buffer, 1, sizeof(buffer), file);
+  fclose(file);
+#else
+  int fd = open(ELECTRON_VERSION_PATH, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  length = (long)read(fd, buffer, sizeof(buffer));
+  close(fd);
+#endif
+
+  size_t i = 0;
+  while (i < (size_t)(length > 0 ? length : 0) && i + 1 < size) {
+    char c = buffer[i];
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+          (c >= 'A' && c <= 'Z') || c == '.' || c == '-' || c == '+')) {
+      break;
+    }
+
+    version[i] = c;
+    i++;
+  }
+  version[i] = '\0';
+
+  return i > 0 && version[0] >= '0' && version[0] <= '9';
+}
+
+// Formats `$HOME/.electron-global/<version>/<file>` into `path`. `file` may
+// be empty to get the install directory itself.
+inline bool formatStorePath(char *path, size_t size, const char *version,
+                            const char *file) {
+  const char *home = getenv(HOME_ENV);
+  if (!home) return false;
+
+  int length = snprintf(path, size, "%s" PATH_SEPARATOR BIN_DIR
+                                    PATH_SEPARATOR "%s" PATH_SEPARATOR "%s",
+                        home, version, file);
+
+  return length > 0 && (size_t)length < size;
+}
+
+// Launch plan written by the installer next to each install, so warm
+// launches can execve the runtime without probing the store. Layout:
+//
+//   LAUNCH_PLAN_MAGIC \0 executable \0
+//   argv[0] \0 ... argv[n] \0 \0
+//   NAME=VALUE \0 ... \0 \0
+//
+// Every field is NUL terminated and both lists end with an empty string, so
+// the stub can parse the plan in place without copying.
+#define LAUNCH_PLAN_FILE "launch_plan"
+#define LAUNCH_PLAN_MAGIC "EGLP1"
+#define LAUNCH_PLAN_MAX_SIZE 8192
+#define LAUNCH_PLAN_MAX_ENTRIES 32
+
+struct LaunchPlan {
+  const char *executable;
+  const char *argv[LAUNCH_PLAN_MAX_ENTRIES + 1];
+  const char *env[LAUNCH_PLAN_MAX_ENTRIES + 1];
+};
+
+// Consumes one NUL terminated list from `data`. Returns the position after
+// the terminating empty string or NULL if the list is malformed.
+inline const char *parseLaunchPlanList(const char *data, const char *end,
+                                       const char **list) {
+  size_t count = 0;
+
+  while (data < end && *data) {
+    const char *terminator = (const char *)memchr(data, '\0', end - data);
+    if (!terminator || count == LAUNCH_PLAN_MAX_ENTRIES) return NULL;
+
+    list[count++] = data;
+    data = terminator + 1;
+  }
+
+  if (data == end) return NULL;
+
+  list[count] = NULL;
+  return data + 1;
+}
+
+// Parses a launch plan in place. `data` must stay alive while `plan` is used.
+inline bool parseLaunchPlan(const char *data, size_t length, LaunchPlan *plan) {
+  const char *end = data + length;
+
+  if (length < sizeof(LAUNCH_PLAN_MAGIC) ||
+      memcmp(data, LAUNCH_PLAN_MAGIC, sizeof(LAUNCH_PLAN_MAGIC)) != 0) {
+    return false;
+  }
+
+  data += sizeof(LAUNCH_PLAN_MAGIC);
+
+  const char *terminator = (const char *)memchr(data, '\0', end - data);
+  if (!terminator || terminator == data || data[0] != '/') return false;
+
+  plan->executable = data;
+  data = terminator + 1;
+
+  data = parseLaunchPlanList(data, end, plan->argv);
+  if (!data || !plan->argv[0]) return false;
+
+  return parseLaunchPlanList(data, end, plan->env) != NULL;
+}
+
+#endif  // ELECTRON_GLOBAL_STORE_HPP
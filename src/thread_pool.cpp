@@ -0,0 +1,54 @@
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+
+  for (size_t i = 0; i < threads; i++) {
+    threads_.push_back(std::thread(&ThreadPool::run, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopping_ = true;
+    queued_.notify_all();
+  }
+
+  for (std::thread &thread : threads_) thread.join();
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  jobs_.push_back(std::move(job));
+  unfinished_++;
+  queued_.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (unfinished_ > 0) finished_.wait(lock);
+}
+
+void ThreadPool::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (;;) {
+    while (jobs_.empty() && !stopping_) queued_.wait(lock);
+    // Queued jobs run before the pool stops.
+    if (jobs_.empty()) return;
+
+    std::function<void()> job = std::move(jobs_.front());
+    jobs_.pop_front();
+    lock.unlock();
+
+    job();
+    // Whatever the job captured goes before the job counts as finished.
+    job = nullptr;
+
+    lock.lock();
+    if (--unfinished_ == 0) finished_.notify_all();
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef ELECTRON_GLOBAL_THREAD_POOL_HPP
+#define ELECTRON_GLOBAL_THREAD_POOL_HPP
+
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads taking jobs from one shared queue. Jobs are
+// taken in the order they were submitted by whichever worker is free, so a
+// few long jobs do not hold up the short ones queued behind them, and
+// submitting the longest first keeps the last one to finish short.
+class ThreadPool {
+ public:
+  // Starts `threads` workers, one per core if 0.
+  explicit ThreadPool(size_t threads = 0);
+
+  // Waits for the queued jobs.
+  ~ThreadPool();
+
+  void submit(std::function<void()> job);
+
+  // Waits until every job submitted so far finished.
+  void wait();
+
+  size_t size() const { return threads_.size(); }
+
+ private:
+  ThreadPool(const ThreadPool &);
+  ThreadPool &operator=(const ThreadPool &);
+
+  void run();
+
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  // Signals workers of a queued job or of stopping.
+  std::condition_variable queued_;
+  // Signals wait() of the last job finishing.
+  std::condition_variable finished_;
+  std::deque<std::function<void()>> jobs_;
+  // Jobs queued or running.
+  size_t unfinished_ = 0;
+  bool stopping_ = false;
+};
+
+#endif  // ELECTRON_GLOBAL_THREAD_POOL_HPP
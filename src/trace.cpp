@@ -0,0 +1,141 @@
+#include "trace.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define TRACE_MAX_EVENTS 128
+#define TRACE_MAX_NAME 48
+#define TRACE_MAX_DETAIL 208
+
+struct TraceEvent {
+  char name[TRACE_MAX_NAME];
+  char detail[TRACE_MAX_DETAIL];
+  uint64_t start;
+  uint64_t end;
+  unsigned long thread;
+  std::atomic<bool> ready;
+};
+
+static const char *tracePath = nullptr;
+static const char *traceCategory = "";
+static TraceEvent traceEvents[TRACE_MAX_EVENTS];
+static std::atomic<unsigned> traceCount(0);
+
+static unsigned long currentThread() {
+#ifdef _WIN32
+  return GetCurrentThreadId();
+#else
+  return (unsigned long)pthread_self();
+#endif
+}
+
+void traceInit(const char *category) {
+  const char *path = getenv(TRACE_ENV);
+  if (!path || !*path) return;
+
+  tracePath = path;
+  traceCategory = category;
+
+  atexit(traceFlush);
+}
+
+bool traceEnabled() { return tracePath != nullptr; }
+
+uint64_t traceNow() {
+#ifdef _WIN32
+  static LARGE_INTEGER frequency;
+  if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+
+  return (uint64_t)(counter.QuadPart / frequency.QuadPart * 1000000 +
+                    counter.QuadPart % frequency.QuadPart * 1000000 /
+                        frequency.QuadPart);
+#else
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return (uint64_t)time.tv_sec * 1000000 + (uint64_t)time.tv_nsec / 1000;
+#endif
+}
+
+// Copies `source` into `target`, dropping characters that would need escaping
+// in a JSON string.
+static void copyEscaped(char *target, size_t size, const char *source) {
+  size_t length = 0;
+
+  for (; source && *source && length + 1 < size; source++) {
+    if (*source == '"' || *source == '\\' || (unsigned char)*source < 0x20) {
+      continue;
+    }
+    target[length++] = *source;
+  }
+
+  target[length] = '\0';
+}
+
+void traceEvent(const char *name, uint64_t start, uint64_t end,
+                const char *detail) {
+  if (!tracePath) return;
+
+  unsigned index = traceCount.fetch_add(1);
+  if (index >= TRACE_MAX_EVENTS) return;
+
+  TraceEvent &event = traceEvents[index];
+  copyEscaped(event.name, sizeof(event.name), name);
+  copyEscaped(event.detail, sizeof(event.detail), detail);
+  event.start = start;
+  event.end = end > start ? end : start;
+  event.thread = currentThread();
+  event.ready.store(true);
+}
+
+void traceFlush() {
+  if (!tracePath) return;
+
+  unsigned count = traceCount.exchange(0);
+  if (count > TRACE_MAX_EVENTS) count = TRACE_MAX_EVENTS;
+  if (!count) return;
+
+  FILE *file = fopen(tracePath, "ab");
+  if (!file) return;
+
+  // The closing bracket is optional in the JSON array format, which lets
+  // every process simply append its events.
+  fseek(file, 0, SEEK_END);
+  bool first = ftell(file) == 0;
+
+#ifdef _WIN32
+  unsigned long process = GetCurrentProcessId();
+#else
+  unsigned long process = (unsigned long)getpid();
+#endif
+
+  for (unsigned i = 0; i < count; i++) {
+    TraceEvent &event = traceEvents[i];
+    if (!event.ready.exchange(false)) continue;
+
+    fprintf(file,
+            "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,"
+            "\"dur\":%llu,\"pid\":%lu,\"tid\":%lu,\"args\":{\"detail\":\"%s\"}}",
+            first ? "[\n" : ",\n", event.name, traceCategory,
+            (unsigned long long)event.start,
+            (unsigned long long)(event.end - event.start), process,
+            event.thread, event.detail);
+    first = false;
+  }
+
+  fputs("\n", file);
+  fclose(file);
+}
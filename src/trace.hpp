@@ -0,0 +1,32 @@
+#ifndef ELECTRON_GLOBAL_TRACE_HPP
+#define ELECTRON_GLOBAL_TRACE_HPP
+
+// Startup phase tracing. When ELECTRON_GLOBAL_TRACE names a file, phases are
+// buffered in memory and appended to it in Chrome's JSON array trace format,
+// which can be loaded in about:tracing or https://ui.perfetto.dev. The stub
+// and the installer append to the same file, so one launch produces a single
+// timeline. Linked into the stub too, so only the C library is used.
+
+#include <stdint.h>
+
+#define TRACE_ENV "ELECTRON_GLOBAL_TRACE"
+
+// Enables tracing if TRACE_ENV is set. `category` tells the executables
+// apart in the trace.
+void traceInit(const char *category);
+
+bool traceEnabled();
+
+// Monotonic timestamp in microseconds, comparable across processes.
+uint64_t traceNow();
+
+// Records a phase that ran from `start` to `end`. `detail`, if given, is shown
+// in the event's arguments.
+void traceEvent(const char *name, uint64_t start, uint64_t end,
+                const char *detail = nullptr);
+
+// Appends the buffered events to the trace file. Called on exit, and must be
+// called before exec since that skips exit handlers.
+void traceFlush();
+
+#endif  // ELECTRON_GLOBAL_TRACE_HPP
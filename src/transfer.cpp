@@ -0,0 +1,188 @@
+#include "transfer.hpp"
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include "config.hpp"
+#include "output_file.hpp"
+
+// Larger files are not from this installer.
+#define TLS_SESSIONS_MAX_SIZE (1 << 20)
+
+namespace fs = ghc::filesystem;
+
+static CURLSH *share = nullptr;
+static std::mutex locks[CURL_LOCK_DATA_LAST];
+static fs::path sessionsPath;
+
+static void lockShare(CURL *curl, curl_lock_data data,
+                      curl_lock_access access, void *userp) {
+  locks[data].lock();
+}
+
+static void unlockShare(CURL *curl, curl_lock_data data, void *userp) {
+  locks[data].unlock();
+}
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+// The file holds the magic followed by one record per session: the time it
+// expires as 8 bytes, then the session key, its salted hash and the session
+// itself, each as 4 bytes of length and the data. All numbers are little
+// endian.
+
+static void appendNumber(std::string *data, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) data->push_back((char)(value >> (i * 8)));
+}
+
+static void appendField(std::string *data, const void *field, size_t length) {
+  appendNumber(data, length, 4);
+  data->append((const char *)field, length);
+}
+
+static bool readNumber(const std::string &data, size_t *position, int bytes,
+                       uint64_t *value) {
+  if (data.size() - *position < (size_t)bytes) return false;
+
+  *value = 0;
+  for (int i = 0; i < bytes; i++) {
+    *value |= (uint64_t)(unsigned char)data[*position + i] << (i * 8);
+  }
+
+  *position += bytes;
+  return true;
+}
+
+static bool readField(const std::string &data, size_t *position,
+                      std::string *field) {
+  uint64_t length;
+  if (!readNumber(data, position, 4, &length) ||
+      data.size() - *position < length) {
+    return false;
+  }
+
+  field->assign(data, *position, (size_t)length);
+  *position += (size_t)length;
+  return true;
+}
+
+static void loadTlsSessions(CURL *curl) {
+  std::ifstream file(sessionsPath.string().c_str(), std::ios::binary);
+
+  std::string data(TLS_SESSIONS_MAX_SIZE + 1, '\0');
+  file.read(&data[0], data.size());
+  data.resize((size_t)file.gcount());
+
+  if (data.size() > TLS_SESSIONS_MAX_SIZE ||
+      data.compare(0, sizeof(TLS_SESSIONS_MAGIC) - 1, TLS_SESSIONS_MAGIC) !=
+          0) {
+    return;
+  }
+
+  size_t position = sizeof(TLS_SESSIONS_MAGIC) - 1;
+  uint64_t now = (uint64_t)time(nullptr);
+
+  uint64_t validUntil;
+  std::string key, hmac, session;
+  while (readNumber(data, &position, 8, &validUntil) &&
+         readField(data, &position, &key) &&
+         readField(data, &position, &hmac) &&
+         readField(data, &position, &session)) {
+    if (validUntil <= now) continue;
+
+    curl_easy_ssls_import(curl, key.empty() ? nullptr : key.c_str(),
+                          (const unsigned char *)hmac.data(), hmac.size(),
+                          (const unsigned char *)session.data(),
+                          session.size());
+  }
+}
+
+static CURLcode exportSession(CURL *curl, void *userp, const char *key,
+                              const unsigned char *hmac, size_t hmacLength,
+                              const unsigned char *session,
+                              size_t sessionLength, curl_off_t validUntil,
+                              int tlsVersion, const char *alpn,
+                              size_t earlyData) {
+  std::string *data = (std::string *)userp;
+
+  appendNumber(data, validUntil > 0 ? (uint64_t)validUntil : 0, 8);
+  appendField(data, key, key ? strlen(key) : 0);
+  appendField(data, hmac, hmacLength);
+  appendField(data, session, sessionLength);
+
+  return CURLE_OK;
+}
+#endif
+
+void initTransfers(const fs::path &store) {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  share = curl_share_init();
+  if (!share) return;
+
+  curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+  curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+  if (getConfig("tls_sessions", "on") == "off") return;
+
+  sessionsPath = store / TLS_SESSIONS_FILE;
+
+  CURL *curl = curl_easy_init();
+  if (!curl) return;
+
+  curl_easy_setopt(curl, CURLOPT_SHARE, share);
+  loadTlsSessions(curl);
+  curl_easy_cleanup(curl);
+#endif
+}
+
+CURLSH *transferShare() { return share; }
+
+void saveTlsSessions() {
+#if LIBCURL_VERSION_NUM >= 0x080c00
+  if (!share || sessionsPath.empty()) return;
+
+  CURL *curl = curl_easy_init();
+  if (!curl) return;
+
+  std::string data = TLS_SESSIONS_MAGIC;
+
+  curl_easy_setopt(curl, CURLOPT_SHARE, share);
+  CURLcode result = curl_easy_ssls_export(curl, exportSession, &data);
+  curl_easy_cleanup(curl);
+
+  // Not built into every libcurl.
+  if (result != CURLE_OK) return;
+
+  // The sessions let anyone reading them resume the connections, so only
+  // the user may read the file. It is created that way rather than narrowed
+  // after, when it could already be open, and a leftover is removed first
+  // since an existing file keeps its permissions. On Windows the file takes
+  // the permissions of the store in the user's profile.
+  fs::path tempPath = sessionsPath;
+  tempPath += ".tmp";
+
+  std::error_code ec;
+  fs::remove(tempPath, ec);
+  {
+    OutputFile file;
+    if (!file.open(tempPath.string().c_str(), false, 0600)) return;
+
+    if (!file.write(data.data(), data.size(), 0) || !file.close()) {
+      file.close();
+      fs::remove(tempPath, ec);
+      return;
+    }
+  }
+
+  fs::rename(tempPath, sessionsPath, ec);
+  if (ec) fs::remove(tempPath, ec);
+#endif
+}
@@ -0,0 +1,30 @@
+#ifndef ELECTRON_GLOBAL_TRANSFER_HPP
+#define ELECTRON_GLOBAL_TRANSFER_HPP
+
+#include <curl/curl.h>
+
+#include "lib/filesystem.hpp"
+
+// Caches shared by every transfer of the installer: resolved names, open
+// connections and TLS sessions. The registry lookup, the redirects to the
+// CDN and the ranges of the download then set up each host only once.
+//
+// With libcurl 8.12 or later the TLS sessions are also kept in the store, so
+// the next install resumes its handshakes instead of starting over.
+#define TLS_SESSIONS_FILE "tls_sessions"
+#define TLS_SESSIONS_MAGIC "EGTLS1"
+
+// Initializes libcurl and the caches, loading the TLS sessions kept in
+// `store` unless the `tls_sessions` setting is `off`. Must be called before
+// any transfer starts.
+void initTransfers(const ghc::filesystem::path &store);
+
+// Cache for the transfers of the installer, which run one thread at a time.
+// libcurl does not support using pooled connections from concurrent threads,
+// so transfers running alongside others must not use it.
+CURLSH *transferShare();
+
+// Saves the TLS sessions for the next install.
+void saveTlsSessions();
+
+#endif  // ELECTRON_GLOBAL_TRANSFER_HPP
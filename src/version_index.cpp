@@ -0,0 +1,161 @@
+#include "version_index.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+#include "semver.hpp"
+
+struct ParsedVersion {
+  SemVer version;
+  const std::string *name;
+};
+
+static bool olderThan(const ParsedVersion &a, const ParsedVersion &b) {
+  return compareSemVer(a.version, b.version) < 0;
+}
+
+static bool majorAbove(unsigned major, const VersionIndexRecord &record) {
+  return major < record.major;
+}
+
+// Newest record of `major` in a run sorted by semver, or NULL.
+static const VersionIndexRecord *findNewestIn(const VersionIndexRecord *begin,
+                                              const VersionIndexRecord *end,
+                                              unsigned major) {
+  const VersionIndexRecord *last =
+      std::upper_bound(begin, end, major, majorAbove);
+
+  if (last == begin || last[-1].major != major) return nullptr;
+
+  return last - 1;
+}
+
+std::string VersionIndex::build(const std::vector<std::string> &versions,
+                                const std::string &etag,
+                                const std::string &lastModified) {
+  std::vector<ParsedVersion> stable, prerelease;
+
+  for (const std::string &name : versions) {
+    ParsedVersion parsed;
+    if (!parseSemVer(name.data(), name.size(), &parsed.version)) continue;
+
+    parsed.name = &name;
+    (parsed.version.prerelease.empty() ? stable : prerelease)
+        .push_back(parsed);
+  }
+
+  std::sort(stable.begin(), stable.end(), olderThan);
+  std::sort(prerelease.begin(), prerelease.end(), olderThan);
+
+  std::string strings;
+  std::vector<VersionIndexRecord> records;
+
+  for (const std::vector<ParsedVersion> *run : {&stable, &prerelease}) {
+    for (const ParsedVersion &parsed : *run) {
+      VersionIndexRecord record;
+      record.major = parsed.version.major;
+      record.minor = parsed.version.minor;
+      record.patch = parsed.version.patch;
+      record.nameOffset = (uint32_t)strings.size();
+      record.nameLength = (uint32_t)parsed.name->size();
+      records.push_back(record);
+
+      strings += *parsed.name;
+    }
+  }
+
+  VersionIndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, VERSION_INDEX_MAGIC, sizeof(header.magic));
+  header.stableCount = (uint32_t)stable.size();
+  header.prereleaseCount = (uint32_t)prerelease.size();
+  header.etagOffset = (uint32_t)strings.size();
+  header.etagLength = (uint32_t)etag.size();
+  strings += etag;
+  header.lastModifiedOffset = (uint32_t)strings.size();
+  header.lastModifiedLength = (uint32_t)lastModified.size();
+  strings += lastModified;
+  header.stringsSize = (uint32_t)strings.size();
+
+  std::string data((const char *)&header, sizeof(header));
+  if (!records.empty()) {
+    data.append((const char *)records.data(),
+                records.size() * sizeof(VersionIndexRecord));
+  }
+  data += strings;
+
+  return data;
+}
+
+bool VersionIndex::open(const char *path) {
+  return file_.open(path) && load(file_.data(), file_.size());
+}
+
+bool VersionIndex::load(const unsigned char *data, size_t size) {
+  header_ = nullptr;
+
+  if (size < sizeof(VersionIndexHeader)) return false;
+
+  const VersionIndexHeader *header = (const VersionIndexHeader *)data;
+  if (memcmp(header->magic, VERSION_INDEX_MAGIC, sizeof(header->magic))) {
+    return false;
+  }
+
+  uint64_t records = (uint64_t)header->stableCount + header->prereleaseCount;
+  uint64_t expected = sizeof(VersionIndexHeader) +
+                      records * sizeof(VersionIndexRecord) +
+                      header->stringsSize;
+  if (expected != size) return false;
+
+  const VersionIndexRecord *stable =
+      (const VersionIndexRecord *)(data + sizeof(VersionIndexHeader));
+  const char *strings = (const char *)(stable + records);
+
+  for (uint64_t i = 0; i < records; i++) {
+    if ((uint64_t)stable[i].nameOffset + stable[i].nameLength >
+        header->stringsSize) {
+      return false;
+    }
+  }
+
+  if ((uint64_t)header->etagOffset + header->etagLength >
+          header->stringsSize ||
+      (uint64_t)header->lastModifiedOffset + header->lastModifiedLength >
+          header->stringsSize) {
+    return false;
+  }
+
+  header_ = header;
+  stable_ = stable;
+  prerelease_ = stable + header->stableCount;
+  strings_ = strings;
+
+  return true;
+}
+
+std::string VersionIndex::findNewest(unsigned major) const {
+  if (!header_) return "";
+
+  const VersionIndexRecord *record =
+      findNewestIn(stable_, stable_ + header_->stableCount, major);
+  if (!record) {
+    record = findNewestIn(prerelease_,
+                          prerelease_ + header_->prereleaseCount, major);
+  }
+
+  return record ? stringAt(record->nameOffset, record->nameLength) : "";
+}
+
+std::string VersionIndex::etag() const {
+  return header_ ? stringAt(header_->etagOffset, header_->etagLength) : "";
+}
+
+std::string VersionIndex::lastModified() const {
+  return header_ ? stringAt(header_->lastModifiedOffset,
+                          header_->lastModifiedLength)
+                 : "";
+}
+
+std::string VersionIndex::stringAt(uint32_t offset, uint32_t length) const {
+  return std::string(strings_ + offset, length);
+}
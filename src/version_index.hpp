@@ -0,0 +1,74 @@
+#ifndef ELECTRON_GLOBAL_VERSION_INDEX_HPP
+#define ELECTRON_GLOBAL_VERSION_INDEX_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+
+// Index of published Electron versions, kept in the store so resolving a
+// major never parses JSON again. The file is used as is through mmap:
+//
+//   VersionIndexHeader
+//   VersionIndexRecord[stableCount]      stable releases in semver order
+//   VersionIndexRecord[prereleaseCount]  pre-releases in semver order
+//   char strings[stringsSize]            version names and validators
+#define VERSION_INDEX_FILE "versions.idx"
+#define VERSION_INDEX_MAGIC "EGVIDX1"
+
+struct VersionIndexHeader {
+  char magic[8];
+  uint32_t stableCount;
+  uint32_t prereleaseCount;
+  uint32_t stringsSize;
+  // ETag and Last-Modified of the registry response the index was built
+  // from, as offsets into the string table.
+  uint32_t etagOffset;
+  uint32_t etagLength;
+  uint32_t lastModifiedOffset;
+  uint32_t lastModifiedLength;
+  uint32_t reserved;
+};
+
+struct VersionIndexRecord {
+  uint32_t major;
+  uint32_t minor;
+  uint32_t patch;
+  uint32_t nameOffset;
+  uint32_t nameLength;
+};
+
+class VersionIndex {
+ public:
+  // Serializes an index of `versions`. Names that are not valid semver are
+  // left out.
+  static std::string build(const std::vector<std::string> &versions,
+                           const std::string &etag,
+                           const std::string &lastModified);
+
+  // Maps an index file written from build().
+  bool open(const char *path);
+
+  // Uses an index held in memory. `data` must outlive the index.
+  bool load(const unsigned char *data, size_t size);
+
+  // Newest stable release of `major`, or its newest pre-release while there
+  // is no stable one yet. Empty if the major is unknown.
+  std::string findNewest(unsigned major) const;
+
+  std::string etag() const;
+  std::string lastModified() const;
+
+ private:
+  std::string stringAt(uint32_t offset, uint32_t length) const;
+
+  MappedFile file_;
+  const VersionIndexHeader *header_ = nullptr;
+  const VersionIndexRecord *stable_ = nullptr;
+  const VersionIndexRecord *prerelease_ = nullptr;
+  const char *strings_ = nullptr;
+};
+
+#endif  // ELECTRON_GLOBAL_VERSION_INDEX_HPP
@@ -0,0 +1,292 @@
+#include "write_behind.hpp"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+struct WriteBuffer {
+  WriteBuffer() {
+#ifdef _WIN32
+    data = (char *)_aligned_malloc(WRITE_BEHIND_BUFFER_SIZE,
+                                   WRITE_BEHIND_ALIGNMENT);
+#else
+    if (posix_memalign((void **)&data, WRITE_BEHIND_ALIGNMENT,
+                       WRITE_BEHIND_BUFFER_SIZE) != 0) {
+      data = nullptr;
+    }
+#endif
+  }
+
+  ~WriteBuffer() {
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    free(data);
+#endif
+  }
+
+  char *data = nullptr;
+  size_t length = 0;
+  uint64_t offset = 0;
+  // Bytes of it already in the file.
+  size_t written = 0;
+};
+
+WriteBehind::WriteBehind(OutputFile *file) : file_(file) {
+#ifdef HAVE_LIBURING
+  // Seccomp filters and old kernels refuse io_uring, leaving the thread.
+  io_uring *ring = new io_uring();
+  if (io_uring_queue_init(WRITE_BEHIND_BUFFERS, ring, 0) == 0) {
+    ring_ = ring;
+  } else {
+    delete ring;
+  }
+#endif
+}
+
+WriteBehind::~WriteBehind() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+#ifdef HAVE_LIBURING
+    // The kernel may still be reading the buffers.
+    while (ring_ && inFlight_ > 0) reapRing(true);
+#endif
+
+    stopping_ = true;
+    changed_.notify_all();
+  }
+
+  if (thread_.joinable()) thread_.join();
+
+#ifdef HAVE_LIBURING
+  if (ring_) {
+    io_uring_queue_exit(ring_);
+    delete ring_;
+  }
+#endif
+}
+
+bool WriteBehind::write(const char *data, size_t length, uint64_t offset) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (length > 0 && !failed_) {
+    WriteBuffer *buffer = nullptr;
+    for (WriteBuffer *candidate : open_) {
+      if (candidate->offset + candidate->length == offset) {
+        buffer = candidate;
+        break;
+      }
+    }
+
+    if (!buffer) {
+      buffer = acquire(&lock);
+      if (!buffer) break;
+
+      buffer->offset = offset;
+      buffer->length = buffer->written = 0;
+      open_.push_back(buffer);
+    }
+
+    size_t chunk = WRITE_BEHIND_BUFFER_SIZE - buffer->length;
+    if (chunk > length) chunk = length;
+
+    memcpy(buffer->data + buffer->length, data, chunk);
+    buffer->length += chunk;
+    data += chunk;
+    length -= chunk;
+    offset += chunk;
+
+    if (buffer->length == WRITE_BEHIND_BUFFER_SIZE) submit(buffer);
+  }
+
+  return !failed_;
+}
+
+void WriteBehind::push() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!open_.empty()) submit(open_.front());
+}
+
+bool WriteBehind::flush() {
+  push();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (inFlight_ > 0) {
+#ifdef HAVE_LIBURING
+    if (ring_) {
+      reapRing(true);
+      continue;
+    }
+#endif
+
+    changed_.wait(lock);
+  }
+
+  return !failed_;
+}
+
+std::vector<Range> WriteBehind::pending() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  std::vector<Range> ranges;
+  for (const std::unique_ptr<WriteBuffer> &buffer : buffers_) {
+    bool free = false;
+    for (WriteBuffer *unused : free_) free = free || unused == buffer.get();
+
+    if (!free) {
+      ranges.push_back({buffer->offset + buffer->written,
+                        buffer->offset + buffer->length});
+    }
+  }
+
+  return ranges;
+}
+
+// Returns a buffer to gather writes in, waiting for one to be written if
+// all are taken. Returns null once a write failed.
+WriteBuffer *WriteBehind::acquire(std::unique_lock<std::mutex> *lock) {
+  if (open_.size() >= WRITE_BEHIND_OPEN) submit(open_.front());
+
+  while (!failed_) {
+#ifdef HAVE_LIBURING
+    if (ring_) reapRing(false);
+#endif
+
+    if (!free_.empty()) {
+      WriteBuffer *buffer = free_.back();
+      free_.pop_back();
+      return buffer;
+    }
+
+    if (buffers_.size() < WRITE_BEHIND_BUFFERS) {
+      std::unique_ptr<WriteBuffer> buffer(new WriteBuffer());
+      if (!buffer->data) {
+        failed_ = true;
+        break;
+      }
+
+      buffers_.push_back(std::move(buffer));
+      return buffers_.back().get();
+    }
+
+    // Every buffer is collecting writes, one of them goes as it is.
+    if (inFlight_ == 0) {
+      submit(open_.front());
+      continue;
+    }
+
+#ifdef HAVE_LIBURING
+    if (ring_) {
+      reapRing(true);
+      continue;
+    }
+#endif
+
+    changed_.wait(*lock);
+  }
+
+  return nullptr;
+}
+
+// Called with the mutex held.
+void WriteBehind::submit(WriteBuffer *buffer) {
+  for (size_t i = 0; i < open_.size(); i++) {
+    if (open_[i] == buffer) {
+      open_.erase(open_.begin() + i);
+      break;
+    }
+  }
+
+  inFlight_++;
+
+#ifdef HAVE_LIBURING
+  if (ring_) {
+    submitRing(buffer);
+    return;
+  }
+#endif
+
+  queue_.push_back(buffer);
+
+  if (!thread_.joinable()) {
+    thread_ = std::thread(&WriteBehind::writeQueued, this);
+  }
+  changed_.notify_all();
+}
+
+// Called with the mutex held.
+void WriteBehind::release(WriteBuffer *buffer, bool written) {
+  if (!written) failed_ = true;
+
+  free_.push_back(buffer);
+  inFlight_--;
+  changed_.notify_all();
+}
+
+void WriteBehind::writeQueued() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (;;) {
+    while (queue_.empty() && !stopping_) changed_.wait(lock);
+    if (queue_.empty()) return;
+
+    WriteBuffer *buffer = queue_.front();
+    queue_.pop_front();
+
+    lock.unlock();
+    bool written = file_->write(buffer->data, buffer->length, buffer->offset);
+    lock.lock();
+
+    release(buffer, written);
+  }
+}
+
+#ifdef HAVE_LIBURING
+// Queues what is left of `buffer`. The ring holds as many entries as there
+// are buffers, so there is always room.
+void WriteBehind::submitRing(WriteBuffer *buffer) {
+  io_uring_sqe *sqe = io_uring_get_sqe(ring_);
+  if (!sqe) {
+    release(buffer, false);
+    return;
+  }
+
+  io_uring_prep_write(sqe, file_->descriptor(), buffer->data + buffer->written,
+                      (unsigned)(buffer->length - buffer->written),
+                      buffer->offset + buffer->written);
+  io_uring_sqe_set_data(sqe, buffer);
+
+  // An entry that could not be submitted goes with the next submission.
+  io_uring_submit(ring_);
+}
+
+// Handles the writes that completed, waiting for one if `wait` is set.
+void WriteBehind::reapRing(bool wait) {
+  io_uring_cqe *cqe;
+  if (wait) io_uring_submit(ring_);
+
+  while ((wait ? io_uring_wait_cqe(ring_, &cqe)
+               : io_uring_peek_cqe(ring_, &cqe)) == 0) {
+    WriteBuffer *buffer = (WriteBuffer *)io_uring_cqe_get_data(cqe);
+    int result = cqe->res;
+    io_uring_cqe_seen(ring_, cqe);
+    wait = false;
+
+    if (result == -EINTR || result == -EAGAIN) {
+      submitRing(buffer);
+    } else if (result <= 0) {
+      release(buffer, false);
+    } else if ((buffer->written += (size_t)result) < buffer->length) {
+      submitRing(buffer);
+    } else {
+      release(buffer, true);
+    }
+  }
+}
+#endif
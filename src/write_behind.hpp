@@ -0,0 +1,84 @@
+#ifndef ELECTRON_GLOBAL_WRITE_BEHIND_HPP
+#define ELECTRON_GLOBAL_WRITE_BEHIND_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "output_file.hpp"
+#include "part_file.hpp"
+
+// Writes are gathered into buffers of WRITE_BEHIND_BUFFER_SIZE bytes, aligned
+// to WRITE_BEHIND_ALIGNMENT. Up to WRITE_BEHIND_BUFFERS are in use at once,
+// of which WRITE_BEHIND_OPEN collect writes at different offsets, one per
+// connection writing into the file.
+#define WRITE_BEHIND_BUFFER_SIZE (512 << 10)
+#define WRITE_BEHIND_ALIGNMENT 4096
+#define WRITE_BEHIND_BUFFERS 16
+#define WRITE_BEHIND_OPEN 8
+
+struct WriteBuffer;
+struct io_uring;
+
+// Writes into an OutputFile in the background, so a disk that stalls does
+// not stall the caller until every buffer is taken. Consecutive writes are
+// gathered into large buffers, which are written through io_uring when the
+// installer is built with HAVE_LIBURING and the kernel allows it, and by a
+// writer thread otherwise.
+//
+// Writes are not in the file until flush() returns.
+class WriteBehind {
+ public:
+  explicit WriteBehind(OutputFile *file);
+  ~WriteBehind();
+
+  // Returns false if an earlier write failed.
+  bool write(const char *data, size_t length, uint64_t offset);
+
+  // Starts writing the buffers still collecting writes, without waiting.
+  void push();
+
+  // Waits until every write so far is in the file. Returns false if any of
+  // them failed.
+  bool flush();
+
+  // Ranges written that are not in the file yet.
+  std::vector<Range> pending();
+
+ private:
+  WriteBehind(const WriteBehind &);
+  WriteBehind &operator=(const WriteBehind &);
+
+  WriteBuffer *acquire(std::unique_lock<std::mutex> *lock);
+  void submit(WriteBuffer *buffer);
+  void release(WriteBuffer *buffer, bool written);
+  void writeQueued();
+#ifdef HAVE_LIBURING
+  void submitRing(WriteBuffer *buffer);
+  void reapRing(bool wait);
+#endif
+
+  OutputFile *file_;
+  std::vector<std::unique_ptr<WriteBuffer>> buffers_;
+  std::vector<WriteBuffer *> free_;
+  // Buffers collecting writes, oldest first.
+  std::vector<WriteBuffer *> open_;
+  size_t inFlight_ = 0;
+  bool failed_ = false;
+
+  // Writer thread, started with the first buffer it writes.
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<WriteBuffer *> queue_;
+  std::thread thread_;
+  bool stopping_ = false;
+
+  io_uring *ring_ = nullptr;
+};
+
+#endif  // ELECTRON_GLOBAL_WRITE_BEHIND_HPP
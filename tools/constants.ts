@@ -1,2 +1,9 @@
 export const DEFAULT_EXCLUDE = ['.git', 'node_modules'];
 export const DEFAULT_DEST = './electron-global';
+export const REGISTRY_URL = 'https://registry.npmjs.org/electron';
+export const RELEASES_URL =
+  'https://github.com/electron/electron/releases/download';
+export const RELEASES_API_URL =
+  'https://api.github.com/repos/electron/electron/releases/tags';
+export const MANIFEST_FILE = 'electron_manifest.json';
+export const ARCHS = ['ia32', 'x64', 'armv7l', 'arm64'];
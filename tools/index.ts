@@ -2,11 +2,19 @@ import { ncp } from 'ncp';
 import * as mkp from 'mkdirp';
 import { promisify } from 'util';
 import { join } from 'path';
+import { parse } from 'url';
 import { promises, createWriteStream, existsSync } from 'fs';
 import * as semver from 'semver';
 import * as extract from 'extract-zip';
 import * as rmrf from 'rimraf';
 import { https } from 'follow-redirects';
+import {
+  ARCHS,
+  MANIFEST_FILE,
+  REGISTRY_URL,
+  RELEASES_API_URL,
+  RELEASES_URL,
+} from './constants';
 
 const pkg = require('../package.json');
 
@@ -40,6 +48,131 @@ export const getElectronVersion = async (
   return electronVersion;
 };
 
+export interface RuntimeArtifact {
+  url: string;
+  size: number;
+  sha256: string;
+}
+
+export interface RuntimeManifest {
+  version: string;
+  artifacts: { [platform: string]: RuntimeArtifact };
+}
+
+const fetchText = (
+  url: string,
+  headers: { [name: string]: string } = {},
+): Promise<string> => {
+  return new Promise((resolve, reject): void => {
+    const req = https.get(
+      {
+        ...parse(url),
+        headers: { 'User-Agent': `electron-global/${pkg.version}`, ...headers },
+      },
+      res => {
+        if (res.statusCode !== 200) {
+          res.resume();
+          return reject(new Error(`GET ${url} failed with ${res.statusCode}`));
+        }
+
+        let data = '';
+        res.setEncoding('utf8');
+        res.on('data', (chunk: string) => (data += chunk));
+        res.on('end', () => resolve(data));
+      },
+    );
+
+    req.on('error', err => {
+      reject(err);
+    });
+  });
+};
+
+// Pins the newest release of the major of `electronVersion` that satisfies
+// it, with the archive URL, size and SHA-256 of every `os` artifact, so the
+// launcher does not have to ask the registry on first run.
+export const resolveManifest = async (
+  electronVersion: semver.SemVer,
+  os: 'win32' | 'linux' | 'darwin',
+): Promise<RuntimeManifest> => {
+  const metadata = JSON.parse(
+    await fetchText(REGISTRY_URL, {
+      Accept: 'application/vnd.npm.install-v1+json',
+    }),
+  );
+
+  const version = semver.maxSatisfying(
+    Object.keys(metadata.versions),
+    `>=${electronVersion.version} <${electronVersion.major + 1}.0.0`,
+  );
+
+  if (!version) {
+    throw new Error(`No Electron release matches ${electronVersion.version}.`);
+  }
+
+  const [shasums, release] = await Promise.all([
+    fetchText(`${RELEASES_URL}/v${version}/SHASUMS256.txt`),
+    fetchText(`${RELEASES_API_URL}/v${version}`, {
+      Accept: 'application/vnd.github.v3+json',
+    }),
+  ]);
+
+  const digests = new Map<string, string>();
+  for (const line of shasums.split('\n')) {
+    const match = /^([0-9a-f]{64}) \*?(\S+)$/.exec(line.trim());
+    if (match) digests.set(match[2], match[1]);
+  }
+
+  const sizes = new Map<string, number>();
+  for (const asset of JSON.parse(release).assets) {
+    sizes.set(asset.name, asset.size);
+  }
+
+  const manifest: RuntimeManifest = { version, artifacts: {} };
+
+  for (const arch of ARCHS) {
+    const name = `electron-v${version}-${os}-${arch}.zip`;
+
+    if (digests.has(name) && sizes.has(name)) {
+      manifest.artifacts[`${os}-${arch}`] = {
+        url: `${RELEASES_URL}/v${version}/${name}`,
+        size: sizes.get(name),
+        sha256: digests.get(name),
+      };
+    }
+  }
+
+  return manifest;
+};
+
+// Writes `electron_version` and the manifest of resolveManifest() to `dir`.
+// `electron_version` names the pinned release, which the launcher then
+// installs in a directory of its own and always runs. Without a manifest it
+// only holds the major, and the launcher resolves the newest release of it
+// at first run instead.
+const writeVersion = async (
+  electronVersion: semver.SemVer,
+  os: 'win32' | 'linux' | 'darwin',
+  dir: string,
+): Promise<void> => {
+  let version = `${electronVersion.major}`;
+
+  try {
+    const manifest = await resolveManifest(electronVersion, os);
+
+    await promises.writeFile(
+      join(dir, MANIFEST_FILE),
+      JSON.stringify(manifest, null, 2),
+    );
+
+    version = manifest.version;
+  } catch (e) {
+    console.warn(`Could not pin the Electron release: ${e.message}`);
+  }
+
+  await promises.writeFile(join(dir, 'electron_version'), version);
+};
+
 export const downloadBinaries = (
   os: 'win32' | 'linux' | 'darwin',
 ): Promise<void> => {
@@ -101,15 +234,18 @@ export const createDistWindows = async (
 
     const electronVersion = await getElectronVersion(baseDir);
 
-    await promises.writeFile(
-      join(dest, 'electron_version'),
-      electronVersion.major,
-    );
+    await writeVersion(electronVersion, 'win32', dest);
 
-    await copy(
-      join(__dirname, '../download/win32/electron.exe'),
-      join(dest, 'electron.exe'),
-    );
+    await Promise.all([
+      copy(
+        join(__dirname, '../download/win32/electron.exe'),
+        join(dest, 'electron.exe'),
+      ),
+      copy(
+        join(__dirname, '../download/win32/electron-installer.exe'),
+        join(dest, 'electron-installer.exe'),
+      ),
+    ]);
   } catch (e) {
     console.error(e);
   }
@@ -126,15 +262,18 @@ export const createDistLinux = async (
 
     const electronVersion = await getElectronVersion(baseDir);
 
-    await promises.writeFile(
-      join(dest, 'electron_version'),
-      electronVersion.major,
-    );
+    await writeVersion(electronVersion, 'linux', dest);
 
-    await copy(
-      join(__dirname, '../download/linux/electron'),
-      join(dest, 'electron'),
-    );
+    await Promise.all([
+      copy(
+        join(__dirname, '../download/linux/electron'),
+        join(dest, 'electron'),
+      ),
+      copy(
+        join(__dirname, '../download/linux/electron-installer'),
+        join(dest, 'electron-installer'),
+      ),
+    ]);
   } catch (e) {
     console.error(e);
   }
@@ -160,9 +299,10 @@ export const createDistMac = async (
 
     const electronVersion = await getElectronVersion(baseDir);
 
-    await promises.writeFile(
-      join(contentsPath, 'Resources/electron_version'),
-      electronVersion.major,
+    await writeVersion(
+      electronVersion,
+      'darwin',
+      join(contentsPath, 'Resources'),
     );
 
     await promises.writeFile(
@@ -175,6 +315,10 @@ export const createDistMac = async (
         join(__dirname, '../download/darwin/electron'),
         join(contentsPath, 'MacOS/Electron'),
       ),
+      copy(
+        join(__dirname, '../download/darwin/electron-installer'),
+        join(contentsPath, 'MacOS/electron-installer'),
+      ),
       copy(
         join(__dirname, '../resources/darwin/electron.plist'),
         join(contentsPath, 'Info.plist'),